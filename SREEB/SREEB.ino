@@ -7,6 +7,12 @@
   Author:   Copyright (c) 2015 Thomas Euler, CIN University of Tübingen. 
             All right reserved.
   History:  v0.6 (2015-08-31) first release
+            v0.7 (2026-10-17) recording of A0/A1 (REC), edge-triggered inputs,
+                              status and SRAM reports (STA, MEM), batches 
+                              (BEG/END), timed outputs (SYN, SDV T=), step
+                              table (SQC/SQA/SQP), binary messages (BIN), 
+                              tags, only active ports serviced by the loop,
+                              optional benchmark (SREEB_Benchmark)
         
   --------------------------------------------------------------------------------*/
 #include <RString.h>
@@ -21,22 +27,38 @@
 #define  toutSerHost_ms    500
 #define  toutLastCmd_ms    2000
 
+// Uncomment to run a benchmark of the message handling at start-up; the 
+// results are sent as REM messages (see benchmark.ino)
+//#define SREEB_Benchmark
+
 #define  MODE_unused       -1
 #define  MODE_triggerIn    0  // external pulldown resistor needed!!
 #define  MODE_triggerIn_Lo 1  // using internal pullup resistor
 #define  MODE_triggerOut   2
 #define  MODE_servoOut     3
-#define  MODE_last         3
+#define  MODE_triggerIn_Edge 4  // no debouncing, pin-change interrupt if possible
+#define  MODE_last         4
+
+#define  STA_Tim_Loop      0  // loop period and sections of the main loop,
+#define  STA_Tim_Read      1  // timed for the status report (see status.ino)
+#define  STA_Tim_Handle    2
+#define  STA_Tim_Ports     3
+#define  STA_nTimers       4
+
+#define  SEQ_Mode_Stop     0  // playback modes of the step table (see
+#define  SEQ_Mode_Play     1  // sequence.ino)
+#define  SEQ_Mode_Loop     2
 
 /*--------------------------------------------------------------------------------
   Global general variables
   --------------------------------------------------------------------------------*/
 boolean         isReady;
-int             val, p, pOut;
+int             val, p;
+RCSEdge_t       edge;
 
 // Related to messaging
 //
-RMsgClass       RMsg = RMsgClass();
+RMsgClass       RMsg;
 Msg_t           currMsg, currRpl;
 token_t         currTok; 
 
@@ -46,9 +68,30 @@ typedef struct  {
   int           mode;
   int           pos1, pos2;
   int           linkedServoOut, linkedTriggerOut;
+  int           lastVal;
                 } SPortEntry_t;
 SPortEntry_t    SPortList[RCS_maxServoPorts];
 
+// Ports that need to be serviced in every pass of the main loop, with their
+// handler; rebuilt by "updateActivePorts" when the port modes change. A new
+// port mode only needs an entry in "portHandlers" (NULL=nothing to do)
+//
+typedef void    (*PortHandler_t)(int p);
+typedef struct  {
+  PortHandler_t handler;
+  int           port;
+                } ActivePort_t;
+ActivePort_t    activePorts[RCS_maxServoPorts];
+byte            nActivePorts;
+
+void            pollTriggerIn(int p);
+const PortHandler_t portHandlers[MODE_last +1] = {
+                  pollTriggerIn,  // MODE_triggerIn
+                  pollTriggerIn,  // MODE_triggerIn_Lo
+                  NULL,           // MODE_triggerOut
+                  NULL,           // MODE_servoOut
+                  NULL};          // MODE_triggerIn_Edge, see pollEdgeInputs
+
 //================================================================================
 // METHODS
 //--------------------------------------------------------------------------------
@@ -59,64 +102,156 @@ void setup()
   isReady = false;
   for(int j=0; j<RCS_maxServoPorts; j+=1) {
     SPortList[j].mode = MODE_unused;
+    SPortList[j].linkedServoOut   = -1;
+    SPortList[j].linkedTriggerOut = -1;
   }
+  updateActivePorts();
   
   // Initialize modules
   //
   COM_init();
+  REC_init();
+  SYN_init();
+  SEQ_init();
+  STA_reset();
   // ...
   
   isReady = true;
   RMsg.sendRemMsg(STR_Ready);
+
+#if defined(SREEB_Benchmark)
+  BNC_run();
+#endif
 }
 
 //================================================================================
 void loop() 
 {
+  unsigned long  t0_us, t1_us;
+
+  t0_us   = micros();
+  STA_beginLoop(t0_us);
+
   // Check for message from host (via serial/USB) 
   //
   currTok = RMsg.readMsgFromStream(&currMsg);
+  t1_us   = micros();
+  STA_addTime(STA_Tim_Read, t1_us -t0_us);
   if(currTok != TOK_NONE) {
     //Serial.println(RMsg.getPtrToInBuf());
   
     if(!RMsg.checkMsg(&currMsg, TOK_isCommand) &&
        !COM_checkMsg(&currMsg, TOK_isCommand)) 
     {
-      // Error: Command recognized but parameters invalid/incomplete
+      // Error: Command recognized but parameters invalid/incomplete (within
+      // a batch, reported by its END)
       //
-      RMsg.sendConfirmMsg(TOK_NONE, ERR_AtLeastOneInvalidParam, 0);
+      if(!COM_addToBatch(&currMsg, ERR_AtLeastOneInvalidParam))
+        RMsg.sendConfirmMsg(TOK_NONE, ERR_AtLeastOneInvalidParam, 0);
       currMsg.tok = TOK_NONE;
+      STA_countInvalid();
     }    
     else {
       // Received message from host ...
       //
       COM_handleMsg(&currMsg);
+      STA_addTime(STA_Tim_Handle, micros() -t1_us);
     }  
   }
+  // Send recorded analog data, if any
+  //
+  REC_update();
+
+  // Set timed outputs that are due (only if there is no hardware timer)
+  //
+  SYN_update();
+
+  // Play the step table, if started
+  //
+  SEQ_update();
+
+  // Apply level changes of edge-triggered inputs
+  //
+  t0_us = micros();
+  RobotCS.pollEdgeInputs();
+  while(RobotCS.readEdge(&edge)) {
+    if(SPortList[edge.port].mode == MODE_triggerIn_Edge)
+      applyTriggerIn(edge.port, edge.level);
+  }
+  reportLostEdges();
+  
   // Execute user-defined functions 
   //
-  for(p=0; p<RCS_maxServoPorts; p+=1) {
-    switch (SPortList[p].mode) {
-      case MODE_unused       :
-      case MODE_triggerOut   :
-      case MODE_servoOut     :
-        break;
-
-      case MODE_triggerIn    : 
-      case MODE_triggerIn_Lo :
-        val  = RobotCS.readDigitalDebounced(p);
-        pOut = SPortList[p].linkedServoOut;
-        if(val == HIGH)
-          RobotCS.writeServo_Position(pOut, SPortList[pOut].pos1);
-        else {
-          RobotCS.writeServo_Position(pOut, SPortList[pOut].pos2);
-        }
-        pOut = SPortList[p].linkedTriggerOut;
-        if(pOut >= 0)
-          digitalWrite(RobotCS.getArduinoPin(pOut), val);
-        break;
+  for(byte j=0; j<nActivePorts; j+=1)
+    activePorts[j].handler(activePorts[j].port);
+  STA_addTime(STA_Tim_Ports, micros() -t0_us);
+}
+
+//--------------------------------------------------------------------------------
+void updateActivePorts ()
+// Rebuilds the list of ports serviced by the main loop; to be called after 
+// the mode of a port was changed
+{
+  PortHandler_t  handler;
+
+  nActivePorts = 0;
+  for(int j=0; j<RCS_maxServoPorts; j+=1) {
+    if((SPortList[j].mode < 0) || (SPortList[j].mode > MODE_last))
+      continue;
+    handler = portHandlers[SPortList[j].mode];
+    if(handler != NULL) {
+      activePorts[nActivePorts].handler = handler;
+      activePorts[nActivePorts].port    = j;
+      nActivePorts += 1;
     }
   }
 }
+
+void pollTriggerIn (int p)
+// Handler of debounced input ports: applies a new input level
+{
+  int v = RobotCS.readDigitalDebounced(p);
+
+  if(v != SPortList[p].lastVal)
+    applyTriggerIn(p, v);
+}
+
 //--------------------------------------------------------------------------------
+void applyTriggerIn (int p, int val)
+// Sets the servo and the trigger output linked to input port "p" according to
+// the new input level "val"
+{
+  int pOut;
 
+  SPortList[p].lastVal = val;
+  pOut = SPortList[p].linkedServoOut;
+  if(pOut >= 0) {
+    if(val == HIGH)
+      RobotCS.writeServo_Position(pOut, SPortList[pOut].pos1);
+    else {
+      RobotCS.writeServo_Position(pOut, SPortList[pOut].pos2);
+    }
+  }
+  pOut = SPortList[p].linkedTriggerOut;
+  if(pOut >= 0)
+    digitalWrite(RobotCS.getArduinoPin(pOut), val);
+}
+
+//--------------------------------------------------------------------------------
+void reportLostEdges ()
+// Reports edges of edge-triggered inputs that were lost because the queue was
+// full as "<ERR C=7 E=7,n;" (an event, like lost samples of REC)
+{
+  int  data[2];
+  
+  data[1] = RobotCS.getEdgesLost();
+  if(data[1] == 0)
+    return;
+  data[0] = TOK_SDM;
+  RMsg.beginMsg(TOK_ERR);
+  RMsg.appendDataToMsg('C', MSG_DecFormatChr, 1, data);
+  data[0] = ERR_BufferOverrun;
+  RMsg.appendDataToMsg('E', MSG_DecFormatChr, 2, data);
+  RMsg.sendMsg();
+}
+//--------------------------------------------------------------------------------
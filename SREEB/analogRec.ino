@@ -0,0 +1,261 @@
+/*--------------------------------------------------------------------------------
+  Project:  SREEB - Simple Research Equipment Extension Box
+            Control external scientific equippment using the Arduino-based Robot
+            Controller Shield from Watterott
+  Module:   analogRec
+  Purpose:  Recording of analog inputs A0 and A1 ("REC" command)
+            The inputs are sampled at a fixed rate from the compare interrupt of
+            a hardware timer (ATmega32U4: timer 3) and the ADC interrupt; the
+            sample pairs are put into a ring buffer that is drained by the main
+            loop and sent to the host in blocks:
+            <REC A=a1,a2,... B=b1,b2,...;
+            with a1,..  values of A0 and b1,.. values of A1 (0..1023)
+            If samples are lost because the buffer was full, this is reported
+            as "<ERR C=13 E=7,n;" with n, the number of lost sample pairs.
+            On other boards, the inputs are sampled by the main loop instead;
+            samples that are due while the loop is held up are not taken 
+            later but counted as lost.
+            The internal reference is 2.56 V on the ATmega32U4 (range 2) and
+            1.1 V on other boards (range 1).
+  Author:   Copyright (c) 2015 Thomas Euler, CIN University of Tübingen.
+            All right reserved.
+  History   v0.1 File created
+            v0.2 Range of the internal reference fixed for the ATmega32U4; 
+                 no burst of stale samples after a stall of the main loop
+  --------------------------------------------------------------------------------*/
+#if defined(__AVR_ATmega32U4__)
+  #define REC_HWTimer
+  #define REC_Range_2V56     2     // analogReference(INTERNAL)
+#else
+  #define REC_Range_1V1      1     // analogReference(INTERNAL)
+#endif
+
+#define   REC_BufLen         64    // sample pairs, must be a power of 2
+#define   REC_BlockLen       8     // sample pairs per message to the host
+#define   REC_MinRate_us     200   // two ADC conversions take ~104 us
+#define   REC_PortA0         1     // servo ports that share the pins with A0, A1
+#define   REC_PortA1         2
+
+#define   REC_Range_3V3      3     // analogReference(EXTERNAL), with Aref->3.3V
+#define   REC_Range_5V0      5     // analogReference(DEFAULT)
+
+typedef struct {
+  int     a0, a1;
+          } RECSample_t;
+
+// Single-producer (ISR), single-consumer (loop) ring buffer; "REC_iHead" is
+// only written by the producer and "REC_iTail" only by the consumer
+//
+volatile RECSample_t   REC_buf[REC_BufLen];
+volatile byte          REC_iHead, REC_iTail;
+volatile unsigned int  REC_nOverrun;
+bool                   REC_isRunning;
+
+#if defined(REC_HWTimer)
+volatile byte          REC_iCh;
+volatile int           REC_val0;
+unsigned int           REC_ticks;
+byte                   REC_ADMUX[2], REC_MUX5[2];
+#else
+unsigned long          REC_tNext_us;
+unsigned int           REC_rate_us;
+#endif
+
+//--------------------------------------------------------------------------------
+void REC_init ()
+{
+  REC_isRunning = false;
+  REC_iHead     = 0;
+  REC_iTail     = 0;
+  REC_nOverrun  = 0;
+}
+
+//--------------------------------------------------------------------------------
+void REC_pushSample (int a0, int a1)
+// Called by the producer only
+{
+  byte iNext = (REC_iHead +1) & (REC_BufLen -1);
+
+  if(iNext == REC_iTail) {
+    REC_nOverrun += 1;
+    return;
+  }
+  REC_buf[REC_iHead].a0 = a0;
+  REC_buf[REC_iHead].a1 = a1;
+  REC_iHead = iNext;
+}
+
+//--------------------------------------------------------------------------------
+int  REC_getRefMode (int range)
+{
+  switch (range) {
+#if defined(REC_Range_2V56)
+    case REC_Range_2V56: return INTERNAL;
+#else
+    case REC_Range_1V1 : return INTERNAL;
+#endif
+    case REC_Range_3V3 : return EXTERNAL;
+    case REC_Range_5V0 : return DEFAULT;
+  }
+  return -1;
+}
+
+//--------------------------------------------------------------------------------
+int  REC_start (int rate_us, int range)
+// Starts sampling A0 and A1 every "rate_us" microseconds; returns the number of
+// invalid parameters (0=started)
+{
+  int  ref  = REC_getRefMode(range);
+
+  if((rate_us < REC_MinRate_us) || (ref < 0))
+    return 1;
+  if((SPortList[REC_PortA0].mode != MODE_unused) ||
+     (SPortList[REC_PortA1].mode != MODE_unused))
+    return 1;
+
+  REC_stop();
+  REC_iHead     = 0;
+  REC_iTail     = 0;
+  REC_nOverrun  = 0;
+  analogReference(ref);
+
+#if defined(REC_HWTimer)
+  byte  ch;
+
+  for(int j=0; j<2; j+=1) {
+    ch            = analogPinToChannel(j);
+    REC_ADMUX[j]  = (ref << 6) | (ch & 0x07);
+    REC_MUX5[j]   = (ch & 0x08) ? _BV(MUX5) : 0;
+  }
+  // ADC clock 16 MHz/64 -> ~52 us per conversion, interrupt when done
+  //
+  ADCSRA   = _BV(ADEN) | _BV(ADIF) | _BV(ADIE) | _BV(ADPS2) | _BV(ADPS1);
+  REC_iCh  = 0;
+
+  // Timer 3 free-running with 0.5 us ticks; the compare value is advanced by
+  // the ISR so that the sample clock does not depend on the interrupt latency
+  //
+  REC_ticks = (unsigned int)rate_us *2;
+  noInterrupts();
+  TCCR3A   = 0;
+  TCCR3B   = _BV(CS31);
+  OCR3A    = TCNT3 +REC_ticks;
+  TIFR3    = _BV(OCF3A);
+  TIMSK3  |= _BV(OCIE3A);
+  interrupts();
+#else
+  REC_rate_us  = rate_us;
+  REC_tNext_us = micros();
+#endif
+  REC_isRunning = true;
+  return 0;
+}
+
+//--------------------------------------------------------------------------------
+void REC_stop ()
+{
+  if(!REC_isRunning)
+    return;
+
+#if defined(REC_HWTimer)
+  noInterrupts();
+  TIMSK3  &= ~_BV(OCIE3A);
+  interrupts();
+
+  // Let a running conversion finish, then restore the ADC settings used by
+  // analogRead() (clock 16 MHz/128, no interrupt)
+  //
+  while(ADCSRA & _BV(ADSC));
+  ADCSRA   = _BV(ADEN) | _BV(ADIF) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+  ADCSRB  &= ~_BV(MUX5);
+#endif
+  REC_isRunning = false;
+}
+
+//--------------------------------------------------------------------------------
+#if defined(REC_HWTimer)
+ISR(TIMER3_COMPA_vect)
+{
+  OCR3A += REC_ticks;
+  if(REC_iCh != 0) {
+    // Previous sample pair not yet converted, rate too high
+    //
+    REC_nOverrun += 1;
+    return;
+  }
+  ADCSRB   = (ADCSRB & ~_BV(MUX5)) | REC_MUX5[0];
+  ADMUX    = REC_ADMUX[0];
+  ADCSRA  |= _BV(ADSC);
+  REC_iCh  = 1;
+}
+
+ISR(ADC_vect)
+{
+  if(REC_iCh == 1) {
+    // A0 done, start conversion of A1
+    //
+    REC_val0 = ADC;
+    ADCSRB   = (ADCSRB & ~_BV(MUX5)) | REC_MUX5[1];
+    ADMUX    = REC_ADMUX[1];
+    ADCSRA  |= _BV(ADSC);
+    REC_iCh  = 2;
+  }
+  else {
+    REC_pushSample(REC_val0, ADC);
+    REC_iCh  = 0;
+  }
+}
+#endif
+
+//--------------------------------------------------------------------------------
+void REC_update ()
+// Called by the main loop; sends recorded samples in blocks to the host and
+// reports lost samples
+{
+  int           a[REC_BlockLen], b[REC_BlockLen];
+  int           e[2];
+  byte          n, nAvail;
+  unsigned int  nLost;
+#if !defined(REC_HWTimer)
+  unsigned long dt_us, nMissed;
+
+  dt_us = micros() -REC_tNext_us;
+  if(REC_isRunning && ((long)dt_us >= 0)) {
+    // Take the sample that is due; further samples missed because the loop 
+    // was held up are counted as lost, and the sample clock is resynchronised
+    //
+    REC_pushSample(analogRead(A0), analogRead(A1));
+    nMissed = dt_us /REC_rate_us;
+    REC_tNext_us += (nMissed +1) *REC_rate_us;
+    REC_nOverrun += (nMissed > 0xFFFF) ? 0xFFFF : nMissed;
+  }
+#endif
+  nAvail = (REC_iHead -REC_iTail) & (REC_BufLen -1);
+  if((nAvail >= REC_BlockLen) || (!REC_isRunning && (nAvail > 0))) {
+    for(n=0; (n < REC_BlockLen) && (n < nAvail); n+=1) {
+      a[n] = REC_buf[REC_iTail].a0;
+      b[n] = REC_buf[REC_iTail].a1;
+      REC_iTail = (REC_iTail +1) & (REC_BufLen -1);
+    }
+    RMsg.beginMsg(TOK_REC);
+    RMsg.appendDataToMsg('A', MSG_DecFormatChr, n, a);
+    RMsg.appendDataToMsg('B', MSG_DecFormatChr, n, b);
+    RMsg.sendMsg();
+  }
+  if(REC_nOverrun > 0) {
+    noInterrupts();
+    nLost = REC_nOverrun;
+    REC_nOverrun = 0;
+    interrupts();
+    // An event, not a reply, so it never carries the tag of a command
+    //
+    a[0] = TOK_REC;
+    e[0] = ERR_BufferOverrun;
+    e[1] = nLost;
+    RMsg.beginMsg(TOK_ERR);
+    RMsg.appendDataToMsg('C', MSG_DecFormatChr, 1, a);
+    RMsg.appendDataToMsg('E', MSG_DecFormatChr, 2, e);
+    RMsg.sendMsg();
+  }
+}
+//--------------------------------------------------------------------------------
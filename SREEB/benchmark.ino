@@ -0,0 +1,219 @@
+/*--------------------------------------------------------------------------------
+  Project:  SREEB - Simple Research Equipment Extension Box
+            Control external scientific equippment using the Arduino-based Robot
+            Controller Shield from Watterott
+  Module:   benchmark
+  Purpose:  Microbenchmark of the message handling (only compiled with
+            "#define SREEB_Benchmark", see SREEB.ino); runs once at start-up
+            and sends the results as REM messages, e.g.
+              <REM parse SDV4 1234 msg/s 5678 ns/B 96 B stack;
+            Covered are parsing (readMsgFromStream), checking (checkMsg,
+            COM_checkMsg), composing (appendDataToMsg in all formats) and
+            sending (sendConfirmMsg). The messages are read from and written
+            to a stream in memory, so that the serial link is not included.
+            Each test runs once untimed before it is measured. The stack use is
+            measured by "painting" the free stack below the current frame with
+            the functions of the "MEM" command (see status.ino), which resets
+            the stack high-water mark reported by "MEM";
+            "in" and "out" report the longest message in the input and output
+            buffer, respectively.
+  Author:   Copyright (c) 2015 Thomas Euler, CIN University of Tübingen.
+            All right reserved.
+  History   v0.1 2026-10-17, file created
+            v0.2 2026-10-17, stack painting of status.ino used
+  --------------------------------------------------------------------------------*/
+#if defined(SREEB_Benchmark)
+
+#if defined(__AVR__)
+  #define BNC_DefIterations  200
+#else
+  #define BNC_DefIterations  100000
+#endif
+#define   BNC_nFrames        5
+#define   BNC_MaxResultLen   64
+
+// Stream that repeatedly returns one message (in flash) and counts (and 
+// discards) the bytes written to it; it never makes the transmit queue wait
+//
+class BNC_StreamClass : public Stream
+{
+  public:
+    const char*    frame;
+    int            iFrame, nFrame;
+    unsigned long  nWritten;
+
+    void    setFrame(const char* s)  { frame = s; nFrame = strlen_P(s); iFrame = 0; }
+    int     available()              { return nFrame -iFrame; }
+    int     read()                   { int ch = pgm_read_byte(&frame[iFrame++]);
+                                       if(iFrame >= nFrame) iFrame = 0;
+                                       return ch; }
+    int     peek()                   { return pgm_read_byte(&frame[iFrame]); }
+    void    flush()                  {}
+    size_t  write(uint8_t b)         { (void)b; nWritten += 1; return 1; }
+    int     availableForWrite()      { return 0x7FFF; }
+    using   Print::write;
+};
+
+BNC_StreamClass  BNC_stream;
+unsigned int     BNC_nIter = BNC_DefIterations;
+int              BNC_nStackPaint;
+int              BNC_maxIn, BNC_maxOut;
+
+const char       BNC_frames[BNC_nFrames][48] PROGMEM = {
+                   ">SDM P=1 M=3;",
+                   ">SDV P=1,2,3,4 V=10,20,30,40;",
+                   ">SDV P=1,2,3,4,5,6,7 V=1,0,1,0,1,0,1;",
+                   ">SDV P:00010002 V.FF00;",
+                   ">SDT P=1,2,3 S=10,170;"};
+const char       BNC_names[BNC_nFrames][8] = {"SDM1", "SDV4", "SDV7", "SDVhex", "SDT"};
+
+//--------------------------------------------------------------------------------
+void BNC_paintStack ()
+{
+  BNC_nStackPaint = STA_resetStackPeak();
+}
+
+int  BNC_getStackUsed ()
+// Returns the number of stack bytes below the painting frame that have been
+// used since "BNC_paintStack" was called
+{
+  return BNC_nStackPaint -STA_getMinFree();
+}
+
+//--------------------------------------------------------------------------------
+void BNC_report (const char* sTest, const char* sCase, unsigned long t_us,
+                 unsigned long nBytes, int nStack)
+// Sends the result of a test as REM message
+{
+  char           s[BNC_MaxResultLen];
+  unsigned long  rate, ns;
+
+  if(t_us == 0)
+    t_us = 1;
+  rate = (unsigned long)((1000000.0 *BNC_nIter) /t_us);
+  if(nBytes > 0) {
+    ns = (unsigned long)((1000.0 *t_us) /nBytes);
+    snprintf_P(s, sizeof(s), PSTR("%s %s %lu msg/s %lu ns/B %d B stack"),
+               sTest, sCase, rate, ns, nStack);
+  }
+  else 
+    snprintf_P(s, sizeof(s), PSTR("%s %s %lu msg/s %d B stack"),
+               sTest, sCase, rate, nStack);
+  RMsg.sendRemMsg(s);
+}
+
+//--------------------------------------------------------------------------------
+void BNC_testParse (int iFrame, Msg_t* msg)
+{
+  unsigned long  t_us;
+  int            nStack;
+
+  BNC_stream.setFrame(BNC_frames[iFrame]);
+  if(BNC_stream.nFrame > BNC_maxIn)
+    BNC_maxIn = BNC_stream.nFrame;
+  while(RMsg.readMsgFromStream(msg) == TOK_NONE);
+  BNC_paintStack();
+  t_us   = micros();
+  for(unsigned int i=0; i<BNC_nIter; i+=1)
+    while(RMsg.readMsgFromStream(msg) == TOK_NONE);
+  t_us   = micros() -t_us;
+  nStack = BNC_getStackUsed();
+  BNC_report("parse", BNC_names[iFrame], t_us,
+             (unsigned long)BNC_nIter *BNC_stream.nFrame, nStack);
+}
+
+void BNC_testCheck (int iFrame, Msg_t* msg)
+{
+  unsigned long  t_us;
+  int            nStack, nOk = 0;
+
+  COM_checkMsg(msg, TOK_isCommand);
+  BNC_paintStack();
+  t_us   = micros();
+  for(unsigned int i=0; i<BNC_nIter; i+=1)
+    nOk += RMsg.checkMsg(msg, TOK_isCommand) || COM_checkMsg(msg, TOK_isCommand);
+  t_us   = micros() -t_us;
+  nStack = BNC_getStackUsed();
+  if(nOk != (int)BNC_nIter)
+    RMsg.sendRemMsg((char*)"check failed");
+  BNC_report("check", BNC_names[iFrame], t_us, 0, nStack);
+}
+
+char* BNC_compose (char cFormat, const int data[])
+{
+  RMsg.beginMsg(TOK_SDV);
+  RMsg.appendDataToMsg('P', cFormat, TOK_MaxData, data);
+  RMsg.appendDataToMsg('V', cFormat, TOK_MaxData, data);
+  return RMsg.finalizeMsg();
+}
+
+void BNC_testCompose (char cFormat, const char* sCase)
+{
+  int            data[TOK_MaxData];
+  unsigned long  t_us, nBytes = 0;
+  int            nStack, n;
+  char*          s;
+
+  for(int j=0; j<TOK_MaxData; j+=1)
+    data[j] = (cFormat == MSG_ByteFormatChr) ? 17 *j : -1234 *j;
+  s      = BNC_compose(cFormat, data);
+  BNC_paintStack();
+  t_us   = micros();
+  for(unsigned int i=0; i<BNC_nIter; i+=1)
+    BNC_compose(cFormat, data);
+  t_us   = micros() -t_us;
+  nStack = BNC_getStackUsed();
+  n      = strlen(s);
+  nBytes = (unsigned long)BNC_nIter *n;
+  if(n > BNC_maxOut)
+    BNC_maxOut = n;
+  BNC_report("compose", sCase, t_us, nBytes, nStack);
+}
+
+void BNC_testConfirm ()
+{
+  unsigned long  t_us, nBytes;
+  int            nStack;
+
+  RMsg.sendConfirmMsg(TOK_SDV, ERR_AtLeastOneInvalidParam, 1);
+  BNC_stream.nWritten = 0;
+  BNC_paintStack();
+  t_us   = micros();
+  for(unsigned int i=0; i<BNC_nIter; i+=1)
+    RMsg.sendConfirmMsg(TOK_SDV, (i & 1) ? ERR_None : ERR_AtLeastOneInvalidParam, 1);
+  t_us   = micros() -t_us;
+  nStack = BNC_getStackUsed();
+  nBytes = BNC_stream.nWritten;
+  BNC_report("confirm", "ACK/ERR", t_us, nBytes, nStack);
+}
+
+//--------------------------------------------------------------------------------
+void BNC_run ()
+// Runs all tests; commands are read from and replies are sent to the stream
+// in memory, the results are sent to the host
+{
+  Msg_t  msg;
+  char   s[BNC_MaxResultLen];
+
+  BNC_maxIn  = 0;
+  BNC_maxOut = 0;
+  micros();
+  RMsg.setStream(&BNC_stream, &SerHost);
+
+  for(int j=0; j<BNC_nFrames; j+=1) {
+    BNC_testParse(j, &msg);
+    BNC_testCheck(j, &msg);
+  }
+  BNC_testCompose(MSG_DecFormatChr,  "dec");
+  BNC_testCompose(MSG_WordFormatChr, "word");
+  BNC_testCompose(MSG_ByteFormatChr, "byte");
+  BNC_testConfirm();
+
+  snprintf_P(s, sizeof(s), PSTR("buffers in %d/%d B out %d/%d B, %u iterations"),
+             BNC_maxIn, MSG_MaxInLen, BNC_maxOut, MSG_MaxOutLen, BNC_nIter);
+  RMsg.sendRemMsg(s);
+  RMsg.setStream(&SerHost, NULL);
+}
+
+#endif
+//--------------------------------------------------------------------------------
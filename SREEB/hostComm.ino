@@ -13,7 +13,42 @@
             v0.4 Back to pure serial communication via a propriatory protocol
             v0.5 Moved most functionality to the RMsg class
             v0.6 First release
+            v0.7 Batches of commands (BEG ... END)
+            v0.8 Digital outputs of SDV set together (COM_commitOutputs)
+            v0.9 Timed digital outputs (SYN, SDV with T, see schedule.ino)
+            v0.10 Step table played by the device (SQC, SQA, SQP, see 
+                 sequence.ino)
+            v0.11 SRAM budget and stack high-water mark (MEM, see status.ino)
+            v0.12 Commands of a batch stored without the unused values
   --------------------------------------------------------------------------------*/  
+#define   COM_MaxBatch       6     // commands per batch (<= TOK_MaxData)
+#define   COM_MaxBatchData   48    // values of all commands of a batch
+
+#if COM_MaxBatch > TOK_MaxData
+  #error "The results of a batch are reported in one parameter: COM_MaxBatch must be <= TOK_MaxData"
+#endif
+
+// The commands of a batch are kept without the unused values of "Msg_t";
+// the values of all commands are stored one after the other in a shared 
+// array (ATmega32U4: 6 *8 +48 *2 = 144 bytes instead of 6 *56 = 336 bytes)
+//
+typedef struct {
+  token_t        tok;
+  byte           nParams;
+  char           paramCh[TOK_MaxParams];
+  byte           nData[TOK_MaxParams];
+               } COMBatchCmd_t;
+
+COMBatchCmd_t  COM_batch[COM_MaxBatch];
+int            COM_batchData[COM_MaxBatchData];
+byte           COM_nBatchData;               // values stored
+byte           COM_batchRes[COM_MaxBatch];   // error code per command
+byte           COM_nBatch;                   // commands received
+bool           COM_isBatch = false;
+unsigned long  COM_tBatch_ms;
+
+byte           COM_outPorts, COM_outLevels;  // digital outputs to set (bit
+                                             // per servo port)
   
 //--------------------------------------------------------------------------------  
 void COM_init ()
@@ -42,10 +77,16 @@ bool  COM_checkMsg (Msg_t* msg, bool asCmd)
   switch ((*msg).tok) {
     case TOK_SDM :
     case TOK_SDV :
-      res = (((*msg).nParams == 2) && 
+    case TOK_SDD :
+      res = ((((*msg).nParams == 2) ||
+              (((*msg).nParams == 3) && ((*msg).tok == TOK_SDV) &&
+               ((*msg).paramCh[2] == 'T') &&
+               ((*msg).nData[2] >= 1) && 
+               ((*msg).nData[2] <= 2))) && 
              ((*msg).paramCh[0] == 'P') && 
              ( (((*msg).paramCh[1] == 'M') && ((*msg).tok == TOK_SDM)) || 
-               (((*msg).paramCh[1] == 'V') && ((*msg).tok == TOK_SDV))) &&
+               (((*msg).paramCh[1] == 'V') && ((*msg).tok == TOK_SDV)) ||
+               (((*msg).paramCh[1] == 'D') && ((*msg).tok == TOK_SDD))) &&
              ((*msg).nData[0] > 0) && 
              ((*msg).nData[0] < TOK_MaxData) &&
              ((*msg).nData[1] > 0) &&
@@ -62,8 +103,44 @@ bool  COM_checkMsg (Msg_t* msg, bool asCmd)
       break;
 
     case TOK_CLR :
+    case TOK_BEG :
+    case TOK_END :
+    case TOK_SYN :
+    case TOK_SQC :
       res = ((*msg).nParams == 0);    
       break;
+
+    case TOK_SQA :
+      res = (((*msg).nParams == 3) && 
+             ((*msg).paramCh[0] == 'P') && 
+             ((*msg).paramCh[1] == 'V') &&
+             ((*msg).paramCh[2] == 'D') &&
+             ((*msg).nData[0] > 0) && 
+             ((*msg).nData[0] < TOK_MaxData) &&
+             ((*msg).nData[0] == (*msg).nData[1]) &&
+             ((*msg).nData[2] == 1));    
+      break;
+
+    case TOK_SQP :
+      res = (((*msg).nParams == 1) && 
+             ((*msg).paramCh[0] == 'M') && 
+             ((*msg).nData[0] >= 1) && 
+             ((*msg).nData[0] <= 2));    
+      break;
+
+    case TOK_REC :
+      res = (((*msg).nParams == 1) && 
+             ((*msg).paramCh[0] == 'R') && 
+             ((*msg).nData[0] >= 1) && 
+             ((*msg).nData[0] <= 2));    
+      break;
+
+    case TOK_MEM :
+      res = (((*msg).nParams == 0) ||
+             (((*msg).nParams == 1) && 
+              ((*msg).paramCh[0] == 'R') && 
+              ((*msg).nData[0] == 1)));
+      break;
       
   }
   return res;
@@ -77,8 +154,8 @@ boolean COM_handleMsg (Msg_t* msg)
 // messages. The result reflects if the message was not/could not be handled.
 {
   boolean res   = true;
-  byte    nErrs = 0;
-  int     p1, p2, p3, pin, mode, j, val;
+  byte    errCode;
+  int     errVal, val;
   
   switch ((*msg).tok) {
     case TOK_REM :
@@ -91,16 +168,123 @@ boolean COM_handleMsg (Msg_t* msg)
       RMsg.sendVerMsg(ModuleVer, getFreeSRAM());
       return res;
 
+    case TOK_BIN :
+      // Switch between ASCII (M=0) and binary (M=1) messages; the reply is 
+      // still sent in the current format
+      // >BIN M=1
+      //
+      val  = (*msg).data[0][0];
+      if((val < 0) || (val > 1)) 
+        RMsg.sendConfirmMsg((*msg).tok, ERR_AtLeastOneInvalidParam, 1);
+      else {
+        RMsg.sendConfirmMsg((*msg).tok, ERR_None, 0);
+        RMsg.setBinaryMode(val == 1);
+      }
+      return res;
+
+    case TOK_STA :
+      // Report loop timing and message statistics (see status.ino); with R=1
+      // the statistics are reset after the reply
+      // >STA [R=1]
+      //
+      val  = ((*msg).nParams > 0) ? (*msg).data[0][0] : 0;
+      if((val < 0) || (val > 1))
+        RMsg.sendConfirmMsg((*msg).tok, ERR_AtLeastOneInvalidParam, 1);
+      else {
+        STA_sendStatus();
+        if(val == 1)
+          STA_reset();
+      }
+      return res;
+
+    case TOK_MEM :
+      // Report the SRAM budget and the peak stack use (see status.ino); with
+      // R=1 the peak is reset after the reply
+      // >MEM [R=1]
+      //
+      val  = ((*msg).nParams > 0) ? (*msg).data[0][0] : 0;
+      if((val < 0) || (val > 1))
+        RMsg.sendConfirmMsg((*msg).tok, ERR_AtLeastOneInvalidParam, 1);
+      else {
+        STA_sendMemory();
+        if(val == 1)
+          STA_resetStackPeak();
+      }
+      return res;
+
+    case TOK_BEG :
+      // Start a batch: the following commands are checked and collected, but
+      // applied only by END, which replies for all of them (queries like VER
+      // are still answered immediately)
+      // >BEG
+      //
+      COM_beginBatch();
+      return res;
+
+    case TOK_END :
+      // Apply the commands of the batch together
+      // >END
+      //
+      COM_endBatch();
+      return res;
+
+    case TOK_SYN :
+      // Set the sync point for timed outputs (see schedule.ino); not part of
+      // a batch, because it refers to the time the command is received
+      // >SYN
+      //
+      SYN_sync();
+      RMsg.sendConfirmMsg((*msg).tok, ERR_None, 0);
+      return res;
+  }
+  // Commands that change the setup or outputs are collected, if a batch is 
+  // open, otherwise applied immediately
+  //
+  if(COM_addToBatch(msg, ERR_None))
+    return res;
+  errCode = COM_applyMsg(msg, &errVal);
+  COM_commitOutputs();
+  if(errCode == ERR_CmdNotImplemented) {
+    res     = false;
+    errCode = ERR_None;
+  }
+  if(errCode != ERR_None)
+    RMsg.sendConfirmMsg((*msg).tok, errCode, errVal);
+  else {
+    RMsg.sendConfirmMsg((*msg).tok, ERR_None, 0);      
+  }
+  return res; 
+}
+
+//--------------------------------------------------------------------------------
+byte  COM_applyMsg (Msg_t* msg, int* errVal)
+// Applies a command that changes the setup or outputs; returns the error code
+// (ERR_CmdNotImplemented, if the command is not handled here) and in "errVal"
+// its value, e.g. the number of invalid values. The levels of digital outputs
+// are only collected, to be set by "COM_commitOutputs" (or the scheduler)
+{
+  int     nErrs = 0;
+  int     p1, p2, p3, pin, mode, j, val, t_us;
+  byte    ports = 0, levels = 0, errCode;
+  bool    isTimed;
+  
+  *errVal = 0;  
+  switch ((*msg).tok) {
     case TOK_SDM :
       // Define I/O mode of up to 8 digital pins (=servo ports of the 
       // Watterott Robot Controller). 
       // with [x,..]  servo port index (1...8)
-      //      [y,..]  mode, 0=input, 1=input_low, 2=output, 3=servo
+      //      [y,..]  mode, 0=input, 1=input_low, 2=output, 3=servo,
+      //              4=input_edge
       //              "input"    requires an external pulldown resistor
       //              "input_lo" uses the internal 2k pullup resistor 
       //              (=> closed == LOW!)
+      //              "input_edge" like "input" but not debounced; linked
+      //              outputs (see SDT) follow each level change
       // >SDM P=2,3 M=1,0
       //
+      SEQ_stop();
+      SYN_clear();
       for(j=0; j<(*msg).nData[0]; j+=1) {
         p1   = (*msg).data[0][j] -1;
         mode = (*msg).data[1][j];
@@ -109,14 +293,23 @@ boolean COM_handleMsg (Msg_t* msg)
           nErrs += 1;
         }  
         else {  
-          SPortList[p1].mode = mode;
+          SPortList[p1].mode    = mode;
+          SPortList[p1].lastVal = -1;
+          RobotCS.detachEdgeInput(p1);
           switch (mode) {
             case MODE_triggerIn : 
               pinMode(RobotCS.getArduinoPin(p1), INPUT);
+              RobotCS.resetDebounce(p1);
+              break;
+
+            case MODE_triggerIn_Edge : 
+              pinMode(RobotCS.getArduinoPin(p1), INPUT);
+              RobotCS.attachEdgeInput(p1);
               break;
 
             case MODE_triggerIn_Lo : 
               pinMode(RobotCS.getArduinoPin(p1), INPUT_PULLUP);
+              RobotCS.resetDebounce(p1);
               break;
 
             case MODE_triggerOut : 
@@ -131,6 +324,7 @@ boolean COM_handleMsg (Msg_t* msg)
           }
         }
       }
+      updateActivePorts();
       break;
 
     case TOK_SDV :
@@ -139,8 +333,16 @@ boolean COM_handleMsg (Msg_t* msg)
       // with [x,..]  servo port index (1...8)
       //      [y,..]  value, for output pins : 0=low, 1=high
       //                     for servo pins  : 0..255 as angle (not degrees)      
-      // >SDV P=2,3 V=1,0
+      //      [ms,us] optional, time after SYN to set the outputs (only 
+      //              output pins), see schedule.ino
+      // >SDV P=2,3 V=1,0 [T=ms,us]
       //
+      isTimed = ((*msg).nParams > 2);
+      t_us    = (isTimed && ((*msg).nData[2] > 1)) ? (*msg).data[2][1] : 0;
+      if(isTimed && ((t_us < 0) || (t_us > 999))) {
+        *errVal = 1;
+        return ERR_AtLeastOneInvalidParam;
+      }
       for(j=0; j<(*msg).nData[0]; j+=1) {
         p1   = (*msg).data[0][j] -1;
         val  = (*msg).data[1][j];
@@ -152,18 +354,35 @@ boolean COM_handleMsg (Msg_t* msg)
           switch (SPortList[p1].mode) {
             case MODE_triggerIn : 
             case MODE_triggerIn_Lo :
+            case MODE_triggerIn_Edge :
               break;
 
             case MODE_triggerOut : 
-              digitalWrite(RobotCS.getArduinoPin(p1), val);
+              ports  |= 1 << p1;
+              levels |= (val ? 1 : 0) << p1;
               break;
             
             case MODE_servoOut : 
-              RobotCS.writeServo_Position(p1, val);
+              if(isTimed) 
+                nErrs += 1;
+              else  
+                RobotCS.writeServo_Position(p1, val);
               break;
           }
         }
       }
+      if(isTimed && (ports != 0)) {
+        errCode = SYN_schedule((word)(*msg).data[2][0], t_us, ports, levels);
+        if(errCode != ERR_None) {
+          *errVal = (errCode == ERR_TooLate) ? 
+                    SYN_getLate_ms((word)(*msg).data[2][0], t_us) : 1;
+          return errCode;
+        }
+      }
+      else {
+        COM_outPorts  |= ports;
+        COM_outLevels  = (COM_outLevels & ~ports) | levels;
+      }
       break;
 
     case TOK_SDT :
@@ -175,6 +394,8 @@ boolean COM_handleMsg (Msg_t* msg)
       //      a,b     two servo positions (0...255) for i=0 and i=1
       // >SDT P=s,i,o S=a,b
       //
+      SEQ_stop();
+      SYN_clear();
       p1   = (*msg).data[0][0] -1;
       p2   = (*msg).data[0][1] -1;
       p3   = (*msg).data[0][2] -1;      
@@ -184,6 +405,9 @@ boolean COM_handleMsg (Msg_t* msg)
         nErrs += 1;
       }  
       else {   
+        RobotCS.detachEdgeInput(p1);
+        RobotCS.detachEdgeInput(p2);
+        RobotCS.detachEdgeInput(p3);
         SPortList[p1].mode = MODE_servoOut;
         SPortList[p1].pos1 = (*msg).data[1][0];
         SPortList[p1].pos2 = (*msg).data[1][1];        
@@ -200,14 +424,24 @@ boolean COM_handleMsg (Msg_t* msg)
         pinMode(pin, INPUT_PULLUP);
 
         delay(10);
-        val  = RobotCS.readDigitalDebounced(pin);
-        if(val == HIGH)
-          RobotCS.writeServo_Position(p1, SPortList[p1].pos1);
-        else {
-          RobotCS.writeServo_Position(p1, SPortList[p1].pos2);
-        }
-        if(p3 >= 0)
-          digitalWrite(RobotCS.getArduinoPin(p3), val);
+        RobotCS.resetDebounce(p2);
+        applyTriggerIn(p2, RobotCS.readDigitalDebounced(p2));
+        updateActivePorts();
+      }
+      break;
+
+    case TOK_SDD :
+      // Set the debouncing window of up to 8 digital input pins (=servo 
+      // ports of the Watterott Robot Controller)
+      // with [x,..]  servo port index (1...8)
+      //      [y,..]  window, 1..16 samples taken once per ms
+      // >SDD P=2,3 D=5,16
+      //
+      for(j=0; j<(*msg).nData[0]; j+=1) {
+        p1   = (*msg).data[0][j] -1;
+        val  = (*msg).data[1][j];
+        if(RobotCS.setDebounce(p1, val) < 0) 
+          nErrs += 1;
       }
       break;
 
@@ -215,21 +449,221 @@ boolean COM_handleMsg (Msg_t* msg)
       // Clear all function entries
       // >CLR
       //
+      REC_stop();
+      SEQ_clear();
+      SYN_clear();
+      COM_outPorts = 0;
       for(j=0; j<RCS_maxServoPorts; j+=1) {
         SPortList[j].mode = MODE_unused;
+        SPortList[j].linkedServoOut   = -1;
+        SPortList[j].linkedTriggerOut = -1;
       }
+      updateActivePorts();
       RobotCS.reset();
       break;
 
+    case TOK_REC :
+      // Start/stop sampling of analog inputs A0 and A1 (servo ports 2 and 3, 
+      // which need to be unused)
+      // with rate,   0=stop, >0 rate in [us]
+      //      range,  2=2.56V (ATmega32U4) or 1=1.1V (other boards), 
+      //              3=3.3V (Aref->3.3V), 5=5.0V (default)
+      // >REC R=rate,range
+      //
+      val  = (*msg).data[0][0];
+      if(val == 0)
+        REC_stop();
+      else {
+        mode = ((*msg).nData[0] > 1) ? (*msg).data[0][1] : REC_Range_5V0;
+        nErrs = REC_start(val, mode);
+      }
+      break;
+
+    case TOK_SQC :
+      // Clear the step table (see sequence.ino)
+      // >SQC
+      //
+      SEQ_clear();
+      break;
+
+    case TOK_SQA :
+      // Append a step to the table: set ports to the values, then wait
+      // with [x,..]  servo port index (1...8)
+      //      [y,..]  value, 0..255 (output pins: 0=low, >0=high)
+      //      d       duration of the step in [ms] (1..32767)
+      // >SQA P=2,3 V=1,90 D=d
+      //
+      nErrs = SEQ_addStep(msg);
+      if(nErrs < 0) {
+        *errVal = 1;
+        return ERR_BufferOverrun;
+      }
+      break;
+
+    case TOK_SQP :
+      // Start/stop playing the step table
+      // with mode,   0=stop, 1=play n runs (default: 1), 2=play endlessly
+      // >SQP M=mode,n
+      //
+      mode = (*msg).data[0][0];
+      val  = ((*msg).nData[0] > 1) ? (*msg).data[0][1] : 1;
+      if((mode < SEQ_Mode_Stop) || (mode > SEQ_Mode_Loop) || (val < 1))
+        nErrs += 1;
+      else if(mode == SEQ_Mode_Stop)
+        SEQ_stop();
+      else if(!SEQ_start(mode, val)) {
+        *errVal = 0;
+        return ERR_DeviceNotReady;
+      }
+      break;
+
     default      :
-      res = false;
+      return ERR_CmdNotImplemented;
+  }
+  *errVal = nErrs;
+  return (nErrs > 0) ? ERR_AtLeastOneInvalidParam : ERR_None;
+}
+
+void  COM_commitOutputs ()
+// Sets the digital outputs collected by "COM_applyMsg" all at once; ports 
+// that are no longer outputs (e.g. changed later in a batch) are skipped
+{
+  byte  ports = COM_outPorts;
+
+  for(int j=0; j<RCS_maxServoPorts; j+=1) {
+    if(SPortList[j].mode != MODE_triggerOut)
+      ports &= ~(1 << j);
+  }
+  if(ports != 0)
+    RobotCS.writeDigitalOutputs(ports, COM_outLevels);
+  COM_outPorts = 0;
+}
+
+/*--------------------------------------------------------------------------------
+  Batches of commands
+  --------------------------------------------------------------------------------*/
+bool  COM_isBatchOpen ()
+// Returns true if a batch is open; a batch is discarded if it did not receive 
+// a command for "toutLastCmd_ms"
+{
+  if(COM_isBatch && ((millis() -COM_tBatch_ms) > toutLastCmd_ms))
+    COM_isBatch = false;
+  return COM_isBatch;
+}
+
+void  COM_beginBatch ()
+// Opens a new batch; the commands of a batch already open are discarded. BEG
+// gets no reply, so its tag is discarded, too
+{
+  RMsg.setTag(MSG_NoTag);
+  COM_isBatch   = true;
+  COM_nBatch    = 0;
+  COM_nBatchData = 0;
+  COM_tBatch_ms = millis();
+}
+
+bool  COM_addToBatch (Msg_t* msg, byte errCode)
+// Adds a command to the open batch; "errCode" is its result, if it is invalid
+// (it is then not stored). If there are too many commands, the result of the
+// last one is set to ERR_BufferOverrun, if their values do not fit, the 
+// result of the command. Returns false if no batch is open
+{
+  COMBatchCmd_t*  cmd;
+  int             n = 0;
+
+  if(!COM_isBatchOpen())
+    return false;
+  // The command gets no reply of its own, so its tag must not be passed on
+  // to the next message sent
+  //
+  RMsg.setTag(MSG_NoTag);
+  COM_tBatch_ms = millis();
+  if(COM_nBatch >= COM_MaxBatch) {
+    // Too many commands, the batch will be rejected
+    //
+    COM_batchRes[COM_MaxBatch -1] = ERR_BufferOverrun;
+    return true;
+  }
+  if(errCode == ERR_None) {
+    for(int i=0; i<(*msg).nParams; i+=1)
+      n += (*msg).nData[i];
+    if((COM_nBatchData +n) > COM_MaxBatchData)
+      errCode = ERR_BufferOverrun;
+  }
+  if(errCode == ERR_None) {
+    cmd = &COM_batch[COM_nBatch];
+    (*cmd).tok     = (*msg).tok;
+    (*cmd).nParams = (*msg).nParams;
+    for(int i=0; i<(*msg).nParams; i+=1) {
+      (*cmd).paramCh[i] = (*msg).paramCh[i];
+      (*cmd).nData[i]   = (*msg).nData[i];
+      memcpy(&COM_batchData[COM_nBatchData], (*msg).data[i], 
+             (*msg).nData[i] *sizeof(int));
+      COM_nBatchData   += (*msg).nData[i];
+    }
+  }
+  COM_batchRes[COM_nBatch] = errCode;
+  COM_nBatch += 1;
+  return true;
+}
+
+void  COM_endBatch ()
+// Applies all commands of the batch in one pass, if they are all valid, and
+// sends one reply with the result (error code) of each command:
+//   <ACK C=16 R=0,0,...;       all applied
+//   <ERR C=16 E=4,n R=...;     n commands invalid, none applied
+//   <ERR C=16 E=3,n R=...;     all applied, n of them with invalid values
+//                              (or e.g. timed outputs too late)
+{
+  int   res[COM_MaxBatch], data[2];
+  int   cmd   = TOK_END;
+  byte  nErrs = 0, errCode, iData = 0;
+  int   j, errVal;
+  Msg_t msg;
+
+  if(!COM_isBatchOpen()) {
+    RMsg.sendConfirmMsg(TOK_END, ERR_InvalidOrTooFewParams, 0);
+    return;
+  }
+  COM_isBatch = false;
+  for(j=0; j<COM_nBatch; j+=1) {
+    if(COM_batchRes[j] != ERR_None)
+      nErrs += 1;
   }
   if(nErrs > 0)
-    RMsg.sendConfirmMsg((*msg).tok, ERR_AtLeastOneInvalidParam, nErrs);
+    data[0] = ERR_InvalidOrTooFewParams;
   else {
-    RMsg.sendConfirmMsg((*msg).tok, ERR_None, 0);      
+    for(j=0; j<COM_nBatch; j+=1) {
+      // Restore the message structure of the command
+      //
+      msg.tok     = COM_batch[j].tok;
+      msg.nParams = COM_batch[j].nParams;
+      for(int i=0; i<msg.nParams; i+=1) {
+        msg.paramCh[i] = COM_batch[j].paramCh[i];
+        msg.nData[i]   = COM_batch[j].nData[i];
+        memcpy(msg.data[i], &COM_batchData[iData], msg.nData[i] *sizeof(int));
+        iData         += msg.nData[i];
+      }
+      errCode = COM_applyMsg(&msg, &errVal);
+      if((errCode != ERR_None) && (errCode != ERR_CmdNotImplemented)) {
+        COM_batchRes[j] = errCode;
+        nErrs += 1;
+      }
+    }
+    COM_commitOutputs();
+    data[0] = ERR_AtLeastOneInvalidParam;
   }
-  return res; 
+  data[1] = nErrs;
+  for(j=0; j<COM_nBatch; j+=1)
+    res[j] = COM_batchRes[j];
+
+  RMsg.beginReplyMsg((nErrs > 0) ? TOK_ERR : TOK_ACK);
+  RMsg.appendDataToMsg('C', MSG_DecFormatChr, 1, &cmd);
+  if(nErrs > 0)
+    RMsg.appendDataToMsg('E', MSG_DecFormatChr, 2, data);
+  if(COM_nBatch > 0)
+    RMsg.appendDataToMsg('R', MSG_DecFormatChr, COM_nBatch, res);
+  RMsg.sendMsg();
 }  
 
 //--------------------------------------------------------------------------------
@@ -242,10 +676,10 @@ int getFreeSRAM ()
 {
   int free_memory;
   
-  if((int)__brkval == 0)
-    free_memory = ((int)&free_memory)  -((int)&__bss_end);
+  if(__brkval == 0)
+    free_memory = (int)((uintptr_t)&free_memory -(uintptr_t)&__bss_end);
   else
-    free_memory = ((int)&free_memory) -((int)__brkval);  
+    free_memory = (int)((uintptr_t)&free_memory -(uintptr_t)__brkval);  
   return free_memory;
 }
 //--------------------------------------------------------------------------------
@@ -0,0 +1,203 @@
+/*--------------------------------------------------------------------------------
+  Project:  SREEB - Simple Research Equipment Extension Box
+            Control external scientific equippment using the Arduino-based Robot
+            Controller Shield from Watterott
+  Module:   schedule
+  Purpose:  Timed digital outputs ("SYN" command and "SDV" with time "T")
+              >SYN;
+              >SDV P=x1,x2... V=y1,y2... T=ms[,us];
+            "SYN" sets the sync point; an "SDV" with "T" does not set its
+            outputs immediately but "ms" milliseconds (0..65535) plus "us"
+            microseconds (0..999) after the sync point. The pending outputs
+            are kept in a small time-ordered queue and set from the compare
+            interrupt of a hardware timer (ATmega32U4: timer 3, compare B,
+            0.5 us ticks, shared with analogRec), i.e. independent of the main
+            loop and the serial link. Delays longer than one timer period are
+            bridged by intermediate interrupts. On other boards, the main loop
+            sets the outputs instead.
+            Only digital outputs can be timed (servo positions are anyway
+            applied with the next 20 ms servo frame). If the time has already
+            passed, the outputs are set immediately and the command is
+            answered with "<ERR C=8 E=9,n;", with n the delay in ms.
+            Reconfiguring ports (SDM, SDT, CLR) clears the queue.
+  Author:   Copyright (c) 2015 Thomas Euler, CIN University of Tübingen.
+            All right reserved.
+  History   v0.1 2026-10-17, file created
+            v0.2 2026-10-17, absolute times and cancelling (for sequence.ino)
+  --------------------------------------------------------------------------------*/
+#if defined(__AVR_ATmega32U4__)
+  #define SYN_HWTimer
+#endif
+
+#define   SYN_QueueLen       8     // pending timed outputs
+#define   SYN_MinDelay_us    12    // due within this time -> set now
+#define   SYN_MaxArm_us      16000 // at most half of the timer period
+
+typedef struct {
+  unsigned long  t_us;             // time to set the outputs (micros())
+  byte           ports, levels;    // bit per servo port
+               } SYNEntry_t;
+
+// The queue is sorted by time and shared with the timer interrupt; the main
+// loop changes it only with interrupts disabled
+//
+volatile SYNEntry_t    SYN_queue[SYN_QueueLen];
+volatile byte          SYN_n;
+unsigned long          SYN_t0_us;
+
+//--------------------------------------------------------------------------------
+void SYN_init ()
+{
+  SYN_n     = 0;
+  SYN_t0_us = micros();
+#if defined(SYN_HWTimer)
+  // Timer 3 free-running with 0.5 us ticks (same setting as in analogRec)
+  //
+  noInterrupts();
+  TCCR3A    = 0;
+  TCCR3B    = _BV(CS31);
+  TIMSK3   &= ~_BV(OCIE3B);
+  interrupts();
+#endif
+}
+
+void SYN_sync ()
+// Sets the sync point, to which the times of timed outputs refer
+{
+  SYN_t0_us = micros();
+}
+
+void SYN_clear ()
+// Discards all pending outputs
+{
+  noInterrupts();
+  SYN_n = 0;
+#if defined(SYN_HWTimer)
+  TIMSK3 &= ~_BV(OCIE3B);
+#endif
+  interrupts();
+}
+
+//--------------------------------------------------------------------------------
+int  SYN_schedule (word t_ms, int t_us, byte ports, byte levels)
+// Queues setting the digital outputs "ports" to "levels" at the given time
+// after the sync point. Returns ERR_None, ERR_BufferOverrun if the queue is
+// full or ERR_TooLate, if the time has passed (the outputs are then set now)
+{
+  return SYN_scheduleAt(SYN_t0_us +(unsigned long)t_ms *1000UL +t_us, ports, levels);
+}
+
+int  SYN_scheduleAt (unsigned long t, byte ports, byte levels)
+// Same as "SYN_schedule" but with the time "t" in micros()
+{
+  byte  i;
+
+  if((long)(t -micros()) < SYN_MinDelay_us) {
+    RobotCS.writeDigitalOutputs(ports, levels);
+    return ERR_TooLate;
+  }
+  if(SYN_n >= SYN_QueueLen)
+    return ERR_BufferOverrun;
+
+  noInterrupts();
+  i = SYN_n;
+  while((i > 0) && ((long)(SYN_queue[i-1].t_us -t) > 0)) {
+    SYN_queue[i].t_us   = SYN_queue[i-1].t_us;
+    SYN_queue[i].ports  = SYN_queue[i-1].ports;
+    SYN_queue[i].levels = SYN_queue[i-1].levels;
+    i -= 1;
+  }
+  SYN_queue[i].t_us   = t;
+  SYN_queue[i].ports  = ports;
+  SYN_queue[i].levels = levels;
+  SYN_n += 1;
+  if(i == 0)
+    SYN_release();
+  interrupts();
+  return ERR_None;
+}
+
+void SYN_cancel (unsigned long t, byte ports)
+// Removes a pending output queued for time "t" with "ports", if any
+{
+  byte  i, j;
+
+  noInterrupts();
+  for(i=0; i<SYN_n; i+=1) {
+    if((SYN_queue[i].t_us == t) && (SYN_queue[i].ports == ports)) {
+      for(j=i+1; j<SYN_n; j+=1) {
+        SYN_queue[j-1].t_us   = SYN_queue[j].t_us;
+        SYN_queue[j-1].ports  = SYN_queue[j].ports;
+        SYN_queue[j-1].levels = SYN_queue[j].levels;
+      }
+      SYN_n -= 1;
+      break;
+    }
+  }
+  interrupts();
+}
+
+int  SYN_getLate_ms (word t_ms, int t_us)
+// Returns how many ms the given time after the sync point has passed
+{
+  unsigned long  dt = micros() -(SYN_t0_us +(unsigned long)t_ms *1000UL +t_us);
+
+  return (dt > 32767000UL) ? 32767 : (int)(dt /1000);
+}
+
+//--------------------------------------------------------------------------------
+void SYN_release ()
+// Sets the outputs that are due and sets up the timer for the next ones;
+// called with interrupts disabled (timer interrupt or main loop)
+{
+  unsigned long  t_us = micros();
+  long           dt_us = 0;
+  byte           i, n;
+
+  for(n=0; n<SYN_n; n+=1) {
+    dt_us = (long)(SYN_queue[n].t_us -t_us);
+    if(dt_us >= SYN_MinDelay_us)
+      break;
+    RobotCS.writeDigitalOutputs(SYN_queue[n].ports, SYN_queue[n].levels);
+  }
+  if(n > 0) {
+    for(i=n; i<SYN_n; i+=1) {
+      SYN_queue[i-n].t_us   = SYN_queue[i].t_us;
+      SYN_queue[i-n].ports  = SYN_queue[i].ports;
+      SYN_queue[i-n].levels = SYN_queue[i].levels;
+    }
+    SYN_n -= n;
+  }
+#if defined(SYN_HWTimer)
+  if(SYN_n == 0) {
+    TIMSK3 &= ~_BV(OCIE3B);
+    return;
+  }
+  if(dt_us > SYN_MaxArm_us)
+    dt_us = SYN_MaxArm_us;
+  OCR3B   = TCNT3 +(unsigned int)dt_us *2;
+  TIFR3   = _BV(OCF3B);
+  TIMSK3 |= _BV(OCIE3B);
+#endif
+}
+
+void SYN_update ()
+// Called by the main loop; sets due outputs on boards without hardware timer
+{
+#if !defined(SYN_HWTimer)
+  if(SYN_n > 0) {
+    noInterrupts();
+    SYN_release();
+    interrupts();
+  }
+#endif
+}
+
+//--------------------------------------------------------------------------------
+#if defined(SYN_HWTimer)
+ISR(TIMER3_COMPB_vect)
+{
+  SYN_release();
+}
+#endif
+//--------------------------------------------------------------------------------
@@ -0,0 +1,201 @@
+/*--------------------------------------------------------------------------------
+  Project:  SREEB - Simple Research Equipment Extension Box
+            Control external scientific equippment using the Arduino-based Robot
+            Controller Shield from Watterott
+  Module:   sequence
+  Purpose:  Step table played by the device without host traffic ("SQC",
+            "SQA" and "SQP" commands)
+              >SQC;
+              >SQA P=x1,x2... V=y1,y2... D=ms;
+              >SQP M=mode[,n];
+            "SQC" clears the table, "SQA" appends a step, which sets the
+            given output (0=low, 1=high) and servo ports (0..255) and then
+            lasts "ms" milliseconds (1..32767). "SQP" starts (M=1, n runs,
+            default 1; M=2, endless) or stops (M=0) the playback. When the
+            playback ends, the device sends
+              <SQP N=n S=s;
+            with n, the completed runs and s, the next step (= number of
+            steps, if the last run was completed).
+            The step times are derived from the start time (no drift). The
+            digital outputs of a step are handed to the scheduler (see
+            schedule.ino) when the previous step begins, so that they switch
+            from the timer interrupt; servo ports are set by the main loop.
+            Ports are only set if they are in output or servo mode when the
+            step is due. The table is kept in SRAM; reconfiguring ports (SDM,
+            SDT, CLR) stops the playback.
+  Author:   Copyright (c) 2015 Thomas Euler, CIN University of Tübingen.
+            All right reserved.
+  History   v0.1 2026-10-17, file created
+            v0.2 2026-10-17, a run only counts when its last step is over
+  --------------------------------------------------------------------------------*/
+#define   SEQ_MaxSteps       16
+
+// Playback modes "SEQ_Mode_xxx" are defined in SREEB.ino
+
+typedef struct {
+  word           dur_ms;
+  byte           ports;            // bit per servo port
+  byte           vals[RCS_maxServoPorts];
+               } SEQStep_t;
+
+SEQStep_t        SEQ_steps[SEQ_MaxSteps];
+byte             SEQ_nSteps;
+byte             SEQ_iStep;        // next step to apply
+bool             SEQ_isPlaying;
+bool             SEQ_isQueued;     // outputs of the next step are scheduled
+byte             SEQ_qPorts;       // ... and the ports scheduled
+word             SEQ_nRuns;        // 0=endless
+word             SEQ_nRunsDone;
+unsigned long    SEQ_tStep_us;     // time of the next step
+
+//--------------------------------------------------------------------------------
+void SEQ_init ()
+{
+  SEQ_nSteps    = 0;
+  SEQ_isPlaying = false;
+}
+
+void SEQ_clear ()
+{
+  SEQ_stop();
+  SEQ_nSteps = 0;
+}
+
+int  SEQ_addStep (Msg_t* msg)
+// Appends the step in "msg" (SQA); returns the number of invalid values or
+// -1, if the table is full
+{
+  SEQStep_t*  st;
+  int         nErrs = 0;
+  int         p, val, j;
+
+  if(SEQ_nSteps >= SEQ_MaxSteps)
+    return -1;
+  st = &SEQ_steps[SEQ_nSteps];
+  (*st).ports = 0;
+  for(j=0; j<RCS_maxServoPorts; j+=1)
+    (*st).vals[j] = 0;
+  for(j=0; j<(*msg).nData[0]; j+=1) {
+    p   = (*msg).data[0][j] -1;
+    val = (*msg).data[1][j];
+    if((p < 0) || (p >= RCS_maxServoPorts) || (val < 0) || (val > 255))
+      nErrs += 1;
+    else {
+      (*st).ports  |= 1 << p;
+      (*st).vals[p] = val;
+    }
+  }
+  val = (*msg).data[2][0];
+  if(val < 1)
+    nErrs += 1;
+  else {
+    (*st).dur_ms = val;
+    SEQ_nSteps  += 1;
+  }
+  return nErrs;
+}
+
+//--------------------------------------------------------------------------------
+bool SEQ_start (int mode, int n)
+// Starts the playback from the first step; returns false if the table is
+// empty
+{
+  SEQ_stop();
+  if(SEQ_nSteps == 0)
+    return false;
+  SEQ_nRuns     = (mode == SEQ_Mode_Loop) ? 0 : n;
+  SEQ_nRunsDone = 0;
+  SEQ_iStep     = 0;
+  SEQ_tStep_us  = micros();
+  SEQ_isQueued  = false;
+  SEQ_isPlaying = true;
+  SEQ_update();
+  return true;
+}
+
+void SEQ_stop ()
+// Stops the playback, if running, and sends the event message
+{
+  int  data[1];
+
+  if(!SEQ_isPlaying)
+    return;
+  SEQ_isPlaying = false;
+  if(SEQ_isQueued)
+    SYN_cancel(SEQ_tStep_us, SEQ_qPorts);
+
+  RMsg.beginMsg(TOK_SQP);
+  data[0] = SEQ_nRunsDone;
+  RMsg.appendDataToMsg('N', MSG_DecFormatChr, 1, data);
+  data[0] = SEQ_iStep;
+  RMsg.appendDataToMsg('S', MSG_DecFormatChr, 1, data);
+  RMsg.sendMsg();
+}
+
+//--------------------------------------------------------------------------------
+void SEQ_getOutputs (byte iStep, byte* ports, byte* levels)
+// Returns the digital outputs of a step, limited to the ports in output mode
+{
+  SEQStep_t*  st = &SEQ_steps[iStep];
+
+  *ports  = 0;
+  *levels = 0;
+  for(int j=0; j<RCS_maxServoPorts; j+=1) {
+    if(((*st).ports & (1 << j)) && (SPortList[j].mode == MODE_triggerOut)) {
+      *ports  |= 1 << j;
+      *levels |= ((*st).vals[j] ? 1 : 0) << j;
+    }
+  }
+}
+
+void SEQ_update ()
+// Called by the main loop; applies the next step when it is due and hands
+// the digital outputs of the step after to the scheduler. A run is counted
+// when the duration of its last step has elapsed
+{
+  SEQStep_t*  st;
+  byte        ports, levels;
+  int         iNext;
+
+  if(!SEQ_isPlaying || ((long)(micros() -SEQ_tStep_us) < 0))
+    return;
+  if(SEQ_iStep >= SEQ_nSteps) {
+    // Last step of a run is over
+    //
+    SEQ_nRunsDone += 1;
+    if((SEQ_nRuns != 0) && (SEQ_nRunsDone >= SEQ_nRuns)) {
+      SEQ_isQueued = false;
+      SEQ_stop();
+      return;
+    }
+    SEQ_iStep = 0;
+  }
+  st = &SEQ_steps[SEQ_iStep];
+  if(!SEQ_isQueued) {
+    SEQ_getOutputs(SEQ_iStep, &ports, &levels);
+    if(ports != 0)
+      RobotCS.writeDigitalOutputs(ports, levels);
+  }
+  for(int j=0; j<RCS_maxServoPorts; j+=1) {
+    if(((*st).ports & (1 << j)) && (SPortList[j].mode == MODE_servoOut))
+      RobotCS.writeServo_Position(j, (*st).vals[j]);
+  }
+  SEQ_tStep_us += (unsigned long)(*st).dur_ms *1000UL;
+  SEQ_iStep    += 1;
+
+  // Step after, if any (first step of the next run)
+  //
+  iNext = SEQ_iStep;
+  if((iNext >= SEQ_nSteps) &&
+     ((SEQ_nRuns == 0) || ((SEQ_nRunsDone +1) < SEQ_nRuns)))
+    iNext = 0;
+  SEQ_isQueued = false;
+  if(iNext < SEQ_nSteps) {
+    SEQ_getOutputs(iNext, &ports, &levels);
+    if(ports != 0) {
+      SEQ_isQueued = (SYN_scheduleAt(SEQ_tStep_us, ports, levels) != ERR_BufferOverrun);
+      SEQ_qPorts   = ports;
+    }
+  }
+}
+//--------------------------------------------------------------------------------
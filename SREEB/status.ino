@@ -0,0 +1,304 @@
+/*--------------------------------------------------------------------------------
+  Project:  SREEB - Simple Research Equipment Extension Box
+            Control external scientific equippment using the Arduino-based Robot
+            Controller Shield from Watterott
+  Module:   status
+  Purpose:  Loop timing and message statistics ("STA" command), to find out
+            where time is lost when e.g. a trigger is missed, and SRAM budget
+            ("MEM" command). The status reply uses
+            the hex word format (4 digits per value, unsigned, saturating at
+            FFFF) to fit into one message, also with a tag (see RMsg.h):
+              <STA L:min avg max H:h0..h7 T:rdAvg rdMax hdAvg hdMax ptAvg ptMax
+                   R:rx eTok ePar eCRC eLen eInv X:txLo txHi stalls
+                   dropped;
+            L    loop period in [us] (minimum, average, maximum)
+            H    histogram of the loop period, bins <32, <64, <128 ... <2048,
+                 >=2048 us
+            T    time in [us] spent in reading/parsing messages (rd), handling
+                 commands (hd) and polling the input ports (pt)
+            R    messages received, rejected because of unknown token, invalid
+                 parameter list, wrong checksum (binary), too long and invalid
+                 parameters for the command
+            X    bytes sent (low and high word), messages that had to wait for
+                 space in the transmit queue and REM messages dropped because
+                 it was full
+            The memory report is
+              <MEM D=data,bss,heap B=msg,tx,ports,rec,seq,cmds S=peak,min,now;
+            D    sizes of the sections .data, .bss and heap in bytes
+            B    SRAM used by the large variables: the RMsg object (without
+                 transmit queue), its transmit queue, the port list, the
+                 sample ring buffer of analogRec, the step table and the
+                 messages (current command and reply, batch)
+            S    peak stack use, smallest free SRAM (gap between heap and
+                 stack) and current free SRAM (as in "VER")
+            The free SRAM is "painted" with a pattern before the C runtime
+            starts (section .init3); "MEM" looks for the lowest byte that has
+            been overwritten, so that the peak includes interrupts and deep
+            call chains (e.g. readMsgFromStream, sendMsg) and not only the
+            stack at the time of the query. Sections and stack are only
+            reported on AVR boards (otherwise 0).
+            The benchmark (see benchmark.ino) measures the stack use with the
+            same functions (STA_resetStackPeak, STA_getMinFree); in the host
+            build and the benchmark on other boards, they use a window of 
+            STA_PaintLen bytes below the stack, otherwise they do nothing.
+  Author:   Copyright (c) 2015 Thomas Euler, CIN University of Tübingen.
+            All right reserved.
+  History   v0.1 2026-10-17, file created
+            v0.2 2026-10-17, dropped REM messages instead of high word of the
+                             bytes sent
+            v0.3 2026-10-17, minimum loop period removed to make room for a
+                             tag
+            v0.4 2026-10-17, minimum loop period and high word of the bytes
+                             sent back (MSG_MaxOutLen raised)
+            v0.5 2026-10-17, SRAM budget and stack high-water mark (MEM)
+            v0.6 2026-10-17, window painted only in host and benchmark builds
+  --------------------------------------------------------------------------------*/
+#define   STA_nHistBins      8
+#define   STA_HistShift      5     // first bin: < 32 us
+#define   STA_Paint          0xC5  // pattern of unused SRAM
+
+#if defined(__AVR__)
+  #define STA_StackPaint
+
+// Symbols of the AVR linker script
+extern uint8_t   __data_start, __data_end, __bss_start, __bss_end;
+extern uint8_t   __heap_start, __stack;
+extern int*      __brkval;
+
+void STA_paintAtInit () __attribute__((naked, used, section(".init3")));
+#elif defined(SREEB_Benchmark) || defined(HOST_BUILD)
+  #define STA_WindowPaint
+  #define STA_PaintLen       4096  // window painted below the stack
+  #define STA_PaintMargin    16
+
+uint8_t*         STA_pPaintLow;    // lowest byte of the window
+#endif
+
+// Timer indices "STA_Tim_xxx" are defined in SREEB.ino; the functions take
+// the index, because the IDE declares the prototypes before this type
+typedef struct {
+  unsigned long  tMin_us, tMax_us, tSum_us, n;
+               } STATimer_t;
+
+STATimer_t       STA_timers[STA_nTimers];
+word             STA_hist[STA_nHistBins];
+word             STA_nInvalid;
+unsigned long    STA_tLastLoop_us;
+bool             STA_isFirstLoop;
+
+//--------------------------------------------------------------------------------
+void STA_reset ()
+{
+  for(int j=0; j<STA_nTimers; j+=1) {
+    STA_timers[j].tMin_us = 0xFFFFFFFF;
+    STA_timers[j].tMax_us = 0;
+    STA_timers[j].tSum_us = 0;
+    STA_timers[j].n       = 0;
+  }
+  for(int j=0; j<STA_nHistBins; j+=1)
+    STA_hist[j] = 0;
+  STA_nInvalid    = 0;
+  STA_isFirstLoop = true;
+  RMsg.resetStats();
+}
+
+//--------------------------------------------------------------------------------
+void STA_addTime (byte iTim, unsigned long dt_us)
+{
+  STATimer_t*  tim = &STA_timers[iTim];
+
+  if(dt_us < (*tim).tMin_us)
+    (*tim).tMin_us = dt_us;
+  if(dt_us > (*tim).tMax_us)
+    (*tim).tMax_us = dt_us;
+  (*tim).tSum_us += dt_us;
+  (*tim).n       += 1;
+}
+
+void STA_beginLoop (unsigned long t_us)
+// Called at the start of the main loop, "t_us" is the current time
+{
+  unsigned long  dt_us, v;
+  byte           iBin = 0;
+
+  if(!STA_isFirstLoop) {
+    dt_us = t_us -STA_tLastLoop_us;
+    STA_addTime(STA_Tim_Loop, dt_us);
+    v = dt_us >> STA_HistShift;
+    while((v > 0) && (iBin < (STA_nHistBins -1))) {
+      v    >>= 1;
+      iBin  += 1;
+    }
+    if(STA_hist[iBin] < 0xFFFF)
+      STA_hist[iBin] += 1;
+  }
+  STA_isFirstLoop  = false;
+  STA_tLastLoop_us = t_us;
+}
+
+void STA_countInvalid ()
+// Counts a message that was rejected because the parameters do not fit the
+// command
+{
+  if(STA_nInvalid < 0xFFFF)
+    STA_nInvalid += 1;
+}
+
+//--------------------------------------------------------------------------------
+int  STA_sat (unsigned long v)
+{
+  return (int)((v > 0xFFFF) ? 0xFFFF : v);
+}
+
+int  STA_avg (byte iTim)
+{
+  STATimer_t*  tim = &STA_timers[iTim];
+
+  return STA_sat(((*tim).n > 0) ? (*tim).tSum_us /(*tim).n : 0);
+}
+
+void STA_sendStatus ()
+{
+  const MsgStats_t*  st = RMsg.getStats();
+  int                data[STA_nHistBins];
+  int                n;
+
+  RMsg.beginReplyMsg(TOK_STA);
+  data[0] = STA_sat((STA_timers[STA_Tim_Loop].n > 0) ? 
+                    STA_timers[STA_Tim_Loop].tMin_us : 0);
+  data[1] = STA_avg(STA_Tim_Loop);
+  data[2] = STA_sat(STA_timers[STA_Tim_Loop].tMax_us);
+  RMsg.appendDataToMsg('L', MSG_WordFormatChr, 3, data);
+  for(int j=0; j<STA_nHistBins; j+=1)
+    data[j] = STA_hist[j];
+  RMsg.appendDataToMsg('H', MSG_WordFormatChr, STA_nHistBins, data);
+  n = 0;
+  for(int j=STA_Tim_Read; j<STA_nTimers; j+=1) {
+    data[n++] = STA_avg(j);
+    data[n++] = STA_sat(STA_timers[j].tMax_us);
+  }
+  RMsg.appendDataToMsg('T', MSG_WordFormatChr, n, data);
+  n = 0;
+  data[n++] = (*st).nRx;
+  for(int j=0; j<MSG_nRxErrs; j+=1)
+    data[n++] = (*st).nRxErrs[j];
+  data[n++] = STA_nInvalid;
+  RMsg.appendDataToMsg('R', MSG_WordFormatChr, n, data);
+  data[0] = (word)((*st).nTxBytes & 0xFFFF);
+  data[1] = (word)((*st).nTxBytes >> 16);
+  data[2] = (*st).nTxStalls;
+  data[3] = (*st).nTxDropped;
+  RMsg.appendDataToMsg('X', MSG_WordFormatChr, 4, data);
+  RMsg.sendMsg();
+}
+
+/*--------------------------------------------------------------------------------
+  SRAM budget
+  --------------------------------------------------------------------------------*/
+#if defined(STA_StackPaint)
+void STA_paintAtInit ()
+// Paints all SRAM above .bss; runs before "main", i.e. nothing is on the
+// stack yet, and must not call functions
+{
+  uint8_t*  p = &__heap_start;
+
+  while(p <= &__stack) {
+    *p = STA_Paint;
+    p += 1;
+  }
+}
+
+uint8_t* STA_getHeapEnd ()
+{
+  return (__brkval == 0) ? &__heap_start : (uint8_t*)__brkval;
+}
+#endif
+
+int __attribute__((noinline)) STA_resetStackPeak ()
+// Paints the free SRAM below the current stack again, i.e. resets the stack
+// high-water mark; returns the number of bytes painted. On AVR boards, this 
+// is all SRAM between heap and stack (interrupts are disabled meanwhile, up
+// to ~1 ms), in the host build and the benchmark a window below the stack. 
+// Other boards are left alone, as the memory below the stack is not known 
+// to be unused (result: 0)
+{
+  volatile uint8_t*  p;
+  int                n;
+
+#if defined(STA_StackPaint)
+  noInterrupts();
+  p = STA_getHeapEnd();
+  n = (int)((uint8_t*)SP -p);
+#elif defined(STA_WindowPaint)
+  n = STA_PaintLen;
+  p = (uint8_t*)__builtin_frame_address(0) -STA_PaintMargin -n;
+  STA_pPaintLow = (uint8_t*)p;
+#else
+  return 0;
+#endif
+  for(int i=0; i<n; i+=1)
+    p[i] = STA_Paint;
+#if defined(STA_StackPaint)
+  interrupts();
+#endif
+  return n;
+}
+
+int  STA_getMinFree ()
+// Returns the number of painted bytes (from the heap or the lowest byte of 
+// the window upwards) that have not been used by the stack since
+{
+  volatile uint8_t*  p;
+  uint8_t            *p0, *pEnd;
+
+#if defined(STA_StackPaint)
+  p0   = STA_getHeapEnd();
+  pEnd = &__stack +1;
+#elif defined(STA_WindowPaint)
+  if(STA_pPaintLow == NULL)
+    return 0;
+  p0   = STA_pPaintLow;
+  pEnd = p0 +STA_PaintLen;
+#else
+  return 0;
+#endif
+  p = p0;
+  while((p < pEnd) && (*p == STA_Paint))
+    p += 1;
+  return (int)(p -p0);
+}
+
+void STA_sendMemory ()
+{
+  int  data[6];
+
+#if defined(STA_StackPaint)
+  data[0] = (int)(&__data_end -&__data_start);
+  data[1] = (int)(&__bss_end -&__bss_start);
+  data[2] = (int)(STA_getHeapEnd() -&__heap_start);
+#else
+  data[0] = 0;
+  data[1] = 0;
+  data[2] = 0;
+#endif
+  RMsg.beginReplyMsg(TOK_MEM);
+  RMsg.appendDataToMsg('D', MSG_DecFormatChr, 3, data);
+  data[0] = sizeof(RMsg) -MSG_TxBufLen;
+  data[1] = MSG_TxBufLen;
+  data[2] = sizeof(SPortList);
+  data[3] = sizeof(REC_buf);
+  data[4] = sizeof(SEQ_steps);
+  data[5] = sizeof(currMsg) +sizeof(currRpl) +sizeof(COM_batch) +sizeof(COM_batchData);
+  RMsg.appendDataToMsg('B', MSG_DecFormatChr, 6, data);
+#if defined(STA_StackPaint)
+  data[1] = STA_getMinFree();
+  data[0] = (int)(&__stack -STA_getHeapEnd()) +1 -data[1];
+#else
+  data[0] = 0;
+  data[1] = 0;
+#endif
+  data[2] = getFreeSRAM();
+  RMsg.appendDataToMsg('S', MSG_DecFormatChr, 3, data);
+  RMsg.sendMsg();
+}
+//--------------------------------------------------------------------------------
@@ -0,0 +1,40 @@
+/*--------------------------------------------------------------------------------
+  Project:  SREEB - Simple Research Equipment Extension Box
+            Host (Linux) build
+  Module:   SREEB_bench.cpp
+  Purpose:  Runs the benchmark of the message handling (see benchmark.ino) on
+            the host and writes the results to stdout
+              SREEB_bench [iterations]
+  Author:   Copyright (c) 2015 Thomas Euler, CIN University of Tübingen.
+            All right reserved.
+  History   v0.1 2026-10-17, file created
+  --------------------------------------------------------------------------------*/
+#include <Arduino.h>
+
+extern unsigned int BNC_nIter;
+
+void      setup();
+
+//--------------------------------------------------------------------------------
+static void flushOut ()
+{
+  char    buf[256];
+  size_t  n;
+
+  while ((n = Serial.hostRead(buf, sizeof(buf))) > 0)
+    fwrite(buf, 1, n, stdout);
+  fflush(stdout);
+}
+
+//--------------------------------------------------------------------------------
+int main (int argc, char* argv[])
+{
+  if (argc > 1)
+    BNC_nIter = (unsigned int)strtoul(argv[1], NULL, 10);
+
+  // "setup" runs the benchmark when compiled with SREEB_Benchmark
+  //
+  setup();
+  flushOut();
+  return 0;
+}
@@ -0,0 +1,54 @@
+/*--------------------------------------------------------------------------------
+  Project:  SREEB - Simple Research Equipment Extension Box
+            Host (Linux) build
+  Module:   SREEB_host.cpp
+  Purpose:  Runs the sketch on the host; lines read from stdin are sent to the
+            sketch via "Serial" and its replies are written to stdout. Lines
+            starting with '!' control the simulated hardware (see hostCmd.h)
+  Author:   Copyright (c) 2015 Thomas Euler, CIN University of Tübingen.
+            All right reserved.
+  History   v0.1 2026-10-17, file created
+  --------------------------------------------------------------------------------*/
+#include <Arduino.h>
+#include "hostCmd.h"
+
+#define   HOST_MaxLineLen    1024
+#define   HOST_LoopsPerLine  50
+
+void      setup();
+void      loop();
+
+//--------------------------------------------------------------------------------
+static void flushOut ()
+{
+  char    buf[256];
+  size_t  n;
+
+  while ((n = Serial.hostRead(buf, sizeof(buf))) > 0)
+    fwrite(buf, 1, n, stdout);
+  fflush(stdout);
+}
+
+//--------------------------------------------------------------------------------
+int main ()
+{
+  char  line[HOST_MaxLineLen];
+
+  setup();
+  flushOut();
+  while (fgets(line, sizeof(line), stdin) != NULL) {
+    line[strcspn(line, "\r\n")] = 0;
+    if (line[0] == HOST_CmdChr) {
+      if (!HOST_handleCmd(line, stdout))
+        fprintf(stderr, "Unknown command: %s\n", line);
+    }
+    else
+      Serial.hostWrite(line);
+
+    for (int i = 0; i<HOST_LoopsPerLine; i++) {
+      loop();
+      flushOut();
+    }
+  }
+  return 0;
+}
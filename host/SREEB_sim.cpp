@@ -0,0 +1,314 @@
+/*--------------------------------------------------------------------------------
+  Project:  SREEB - Simple Research Equipment Extension Box
+            Host (Linux) build
+  Module:   SREEB_sim.cpp
+  Purpose:  Virtual SREEB device: runs the sketch continuously and connects its
+            serial port to a pseudo-terminal, which client software can open
+            like the USB device (e.g. /dev/pts/5, see output at start)
+              SREEB_sim [-b baud] [-l link] [-t txBufLen] [-p]
+              -b baud       emulate the transfer time of a serial link with
+                            "baud" bits/s (8N1); default: no emulation
+              -l link       create a symbolic link to the pseudo-terminal
+              -t txBufLen   transmit buffer of the device (bytes, default 64);
+                            when full, the sketch waits as on the board
+              -p            do not sleep when idle (lower latency, full load)
+            Lines read from stdin control the simulated hardware (see
+            hostCmd.h); in addition:
+              !stat         print link and loop statistics
+              !quit         exit
+            While no client has opened the pseudo-terminal, the output of the
+            device is discarded (like the Leonardo without USB host).
+  Author:   Copyright (c) 2015 Thomas Euler, CIN University of Tübingen.
+            All right reserved.
+  History   v0.1 2026-10-17, file created
+  --------------------------------------------------------------------------------*/
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <unistd.h>
+#include <errno.h>
+#include <Arduino.h>
+#include "hostCmd.h"
+
+#define   SIM_MaxLineLen     1024
+#define   SIM_RxQueueLen     4096
+#define   SIM_TxPendLen      256
+#define   SIM_ByteCost       (10ULL *1000000ULL)  // bits per byte x us per s
+#define   SIM_MaxBurst       16                   // bytes
+#define   SIM_IdleWait_ms    1
+#define   SIM_DefTxBufLen    64
+
+typedef struct {
+  unsigned long       t_us;
+  unsigned long long  credit;
+          } SimPace_t;
+
+void      setup();
+void      loop();
+
+static int            fdPty       = -1;
+static const char*    linkPath    = NULL;
+static unsigned long  baud        = 0;
+static bool           isBusy      = false;
+static volatile sig_atomic_t isRunning = 1;
+
+static uint8_t        rxQueue[SIM_RxQueueLen];
+static size_t         nRxQueue    = 0;
+static uint8_t        txPend[SIM_TxPendLen];
+static size_t         nTxPend     = 0, iTxPend = 0;
+static SimPace_t      rxPace, txPace;
+static bool           isConnected = false;
+
+static unsigned long  nRxBytes, nTxBytes, nTxDropped, nLoops, maxLoop_us;
+static unsigned long  nTxWaits;
+
+//--------------------------------------------------------------------------------
+static void onSignal (int sig)
+{
+  (void)sig;
+  isRunning = 0;
+}
+
+static size_t paceBytes (SimPace_t* pace, size_t n)
+// Returns how many of "n" bytes can be transferred now at the emulated baud
+// rate; the credit is refilled with the elapsed time
+{
+  unsigned long  t;
+  size_t         k;
+
+  if (baud == 0)
+    return n;
+  t = micros();
+  (*pace).credit += (unsigned long long)(t -(*pace).t_us) *baud;
+  (*pace).t_us    = t;
+  if ((*pace).credit > SIM_MaxBurst *SIM_ByteCost)
+    (*pace).credit = SIM_MaxBurst *SIM_ByteCost;
+  k = (size_t)((*pace).credit /SIM_ByteCost);
+  if (k > n)
+    k = n;
+  (*pace).credit -= k *SIM_ByteCost;
+  return k;
+}
+
+//--------------------------------------------------------------------------------
+static bool checkConnected ()
+// A client has opened the pseudo-terminal, if the master does not signal a
+// hang-up
+{
+  struct pollfd  pfd = {fdPty, POLLIN, 0};
+
+  poll(&pfd, 1, 0);
+  isConnected = !(pfd.revents & POLLHUP);
+  return isConnected;
+}
+
+static bool pumpRx ()
+// Moves bytes from the pseudo-terminal to the receive buffer of "Serial";
+// returns true, if bytes were moved
+{
+  ssize_t  n;
+  size_t   k;
+
+  if (isConnected && (nRxQueue < SIM_RxQueueLen)) {
+    n = read(fdPty, &rxQueue[nRxQueue], SIM_RxQueueLen -nRxQueue);
+    if (n > 0)
+      nRxQueue += n;
+  }
+  k = nRxQueue;
+  if (k > (size_t)(HOST_SerialBufLen -Serial.available()))
+    k = HOST_SerialBufLen -Serial.available();
+  k = paceBytes(&rxPace, k);
+  if (k == 0)
+    return false;
+  Serial.hostWrite(rxQueue, k);
+  memmove(rxQueue, &rxQueue[k], nRxQueue -k);
+  nRxQueue -= k;
+  nRxBytes += k;
+  return true;
+}
+
+static bool pumpTx ()
+// Moves bytes from the transmit buffer of "Serial" to the pseudo-terminal;
+// returns true, if bytes were moved
+{
+  ssize_t  n;
+  size_t   k;
+
+  if (!isConnected) {
+    // Nobody listening, discard
+    //
+    while ((k = Serial.hostRead((char*)txPend, SIM_TxPendLen)) > 0)
+      nTxDropped += k;
+    nTxPend = 0;
+    iTxPend = 0;
+    return false;
+  }
+  if (nTxPend == iTxPend) {
+    k       = paceBytes(&txPace, Serial.hostAvailable());
+    nTxPend = Serial.hostRead((char*)txPend, (k < SIM_TxPendLen) ? k : SIM_TxPendLen);
+    iTxPend = 0;
+  }
+  if (nTxPend == iTxPend)
+    return false;
+  n = write(fdPty, &txPend[iTxPend], nTxPend -iTxPend);
+  if (n <= 0)
+    return false;
+  iTxPend  += n;
+  nTxBytes += n;
+  return true;
+}
+
+static void onTxFull ()
+// Called by "Serial.write" while the transmit buffer is full
+{
+  nTxWaits += 1;
+  checkConnected();
+  if (!pumpTx())
+    usleep(baud ? (unsigned int)(SIM_ByteCost /baud /10) : 100);
+}
+
+//--------------------------------------------------------------------------------
+static bool handleLine (const char* s)
+{
+  if (strcmp(s, "!quit") == 0)
+    isRunning = 0;
+  else if (strcmp(s, "!stat") == 0)
+    printf("!stat rx=%lu tx=%lu dropped=%lu waits=%lu loops=%lu maxLoop_us=%lu\n",
+           nRxBytes, nTxBytes, nTxDropped, nTxWaits, nLoops, maxLoop_us);
+  else if (!HOST_handleCmd(s, stdout))
+    return false;
+  fflush(stdout);
+  return true;
+}
+
+static void readStdin ()
+// Reads commands from stdin without blocking
+{
+  static char    line[SIM_MaxLineLen];
+  static size_t  nLine = 0;
+  struct pollfd  pfd = {STDIN_FILENO, POLLIN, 0};
+  char           ch;
+
+  while ((poll(&pfd, 1, 0) > 0) && (pfd.revents & (POLLIN | POLLHUP))) {
+    if (read(STDIN_FILENO, &ch, 1) != 1) {
+      // stdin closed, keep running until terminated
+      //
+      close(STDIN_FILENO);
+      return;
+    }
+    if ((ch == '\n') || (nLine == SIM_MaxLineLen -1)) {
+      line[nLine] = 0;
+      nLine       = 0;
+      if ((line[0] == HOST_CmdChr) && !handleLine(line))
+        fprintf(stderr, "Unknown command: %s\n", line);
+    }
+    else if (ch != '\r')
+      line[nLine++] = ch;
+  }
+}
+
+//--------------------------------------------------------------------------------
+static bool openPty ()
+{
+  struct termios  tio;
+  const char*     name;
+  int             fd;
+
+  fdPty = posix_openpt(O_RDWR | O_NOCTTY);
+  if ((fdPty < 0) || (grantpt(fdPty) < 0) || (unlockpt(fdPty) < 0))
+    return false;
+  name = ptsname(fdPty);
+  if (name == NULL)
+    return false;
+
+  // Raw mode, as expected from a USB serial device
+  //
+  fd = open(name, O_RDWR | O_NOCTTY);
+  if (fd >= 0) {
+    if (tcgetattr(fd, &tio) == 0) {
+      cfmakeraw(&tio);
+      tcsetattr(fd, TCSANOW, &tio);
+    }
+    close(fd);
+  }
+  fcntl(fdPty, F_SETFL, fcntl(fdPty, F_GETFL) | O_NONBLOCK);
+
+  if (linkPath != NULL) {
+    unlink(linkPath);
+    if (symlink(name, linkPath) < 0) {
+      perror(linkPath);
+      linkPath = NULL;
+    }
+  }
+  printf("SREEB_sim: device at %s%s%s\n", name,
+         linkPath ? " -> " : "", linkPath ? linkPath : "");
+  fflush(stdout);
+  return true;
+}
+
+//--------------------------------------------------------------------------------
+int main (int argc, char* argv[])
+{
+  struct pollfd  pfds[2];
+  unsigned long  t_us, dt_us;
+  size_t         txBufLen = SIM_DefTxBufLen;
+  bool           isActive;
+  int            opt;
+
+  while ((opt = getopt(argc, argv, "b:l:t:p")) != -1) {
+    switch (opt) {
+      case 'b': baud     = strtoul(optarg, NULL, 10); break;
+      case 'l': linkPath = optarg; break;
+      case 't': txBufLen = strtoul(optarg, NULL, 10); break;
+      case 'p': isBusy   = true; break;
+      default :
+        fprintf(stderr, "usage: %s [-b baud] [-l link] [-t txBufLen] [-p]\n", argv[0]);
+        return 1;
+    }
+  }
+  if (!openPty()) {
+    perror("SREEB_sim: pseudo-terminal");
+    return 1;
+  }
+  signal(SIGINT,  onSignal);
+  signal(SIGTERM, onSignal);
+  signal(SIGPIPE, SIG_IGN);
+
+  Serial.hostSetTxBufLen(txBufLen);
+  Serial.hostSetTxFullHook(onTxFull);
+  rxPace.t_us = micros();
+  txPace.t_us = rxPace.t_us;
+  setup();
+
+  while (isRunning) {
+    checkConnected();
+    isActive  = pumpRx();
+
+    t_us      = micros();
+    loop();
+    dt_us     = micros() -t_us;
+    nLoops   += 1;
+    if (dt_us > maxLoop_us)
+      maxLoop_us = dt_us;
+
+    isActive |= pumpTx();
+    readStdin();
+
+    if (!isBusy && !isActive && (nRxQueue == 0) && (Serial.hostAvailable() == 0)) {
+      // Idle, wait for the next bytes from the client (or a command)
+      //
+      pfds[0].fd     = fdPty;
+      pfds[0].events = POLLIN;
+      pfds[1].fd     = STDIN_FILENO;
+      pfds[1].events = POLLIN;
+      poll(pfds, 2, isConnected ? SIM_IdleWait_ms : 0);
+      if (!isConnected)
+        usleep(SIM_IdleWait_ms *1000);
+    }
+  }
+  if (linkPath != NULL)
+    unlink(linkPath);
+  close(fdPty);
+  return 0;
+}
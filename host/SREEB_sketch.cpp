@@ -0,0 +1,96 @@
+/*--------------------------------------------------------------------------------
+  Project:  SREEB - Simple Research Equipment Extension Box
+            Host (Linux) build
+  Module:   SREEB_sketch.cpp
+  Purpose:  Builds the sketch like the Arduino IDE does: the function
+            prototypes are declared first, then the .ino files are
+            concatenated (main file first, then the others alphabetically)
+  Author:   Copyright (c) 2015 Thomas Euler, CIN University of Tübingen.
+            All right reserved.
+  History   v0.1 2026-10-17, file created
+  --------------------------------------------------------------------------------*/
+#include <Arduino.h>
+#include <RString.h>
+#include <RMsg.h>
+#include "Servo.h"
+#include "RobotCS.h"
+
+// SREEB.ino
+void    updateActivePorts();
+void    pollTriggerIn(int p);
+void    applyTriggerIn(int p, int val);
+void    reportLostEdges();
+
+// analogRec.ino
+void    REC_init();
+void    REC_pushSample(int a0, int a1);
+int     REC_getRefMode(int range);
+int     REC_start(int rate_us, int range);
+void    REC_stop();
+void    REC_update();
+
+// benchmark.ino
+#if defined(SREEB_Benchmark)
+void    BNC_paintStack();
+int     BNC_getStackUsed();
+void    BNC_report(const char* sTest, const char* sCase, unsigned long t_us,
+                   unsigned long nBytes, int nStack);
+void    BNC_testParse(int iFrame, Msg_t* msg);
+void    BNC_testCheck(int iFrame, Msg_t* msg);
+char*   BNC_compose(char cFormat, const int data[]);
+void    BNC_testCompose(char cFormat, const char* sCase);
+void    BNC_testConfirm();
+void    BNC_run();
+#endif
+
+// hostComm.ino
+void    COM_init();
+bool    COM_checkMsg(Msg_t* msg, bool asCmd);
+boolean COM_handleMsg(Msg_t* msg);
+byte    COM_applyMsg(Msg_t* msg, int* errVal);
+void    COM_commitOutputs();
+bool    COM_isBatchOpen();
+void    COM_beginBatch();
+bool    COM_addToBatch(Msg_t* msg, byte errCode);
+void    COM_endBatch();
+int     getFreeSRAM();
+
+// schedule.ino
+void    SYN_init();
+void    SYN_sync();
+void    SYN_clear();
+int     SYN_schedule(word t_ms, int t_us, byte ports, byte levels);
+int     SYN_scheduleAt(unsigned long t, byte ports, byte levels);
+void    SYN_cancel(unsigned long t, byte ports);
+int     SYN_getLate_ms(word t_ms, int t_us);
+void    SYN_release();
+void    SYN_update();
+
+// sequence.ino
+void    SEQ_init();
+void    SEQ_clear();
+int     SEQ_addStep(Msg_t* msg);
+bool    SEQ_start(int mode, int n);
+void    SEQ_stop();
+void    SEQ_getOutputs(byte iStep, byte* ports, byte* levels);
+void    SEQ_update();
+
+// status.ino
+void    STA_reset();
+void    STA_addTime(byte iTim, unsigned long dt_us);
+void    STA_beginLoop(unsigned long t_us);
+void    STA_countInvalid();
+int     STA_sat(unsigned long v);
+int     STA_avg(byte iTim);
+void    STA_sendStatus();
+int     STA_resetStackPeak();
+int     STA_getMinFree();
+void    STA_sendMemory();
+
+#include "SREEB.ino"
+#include "analogRec.ino"
+#include "benchmark.ino"
+#include "hostComm.ino"
+#include "schedule.ino"
+#include "sequence.ino"
+#include "status.ino"
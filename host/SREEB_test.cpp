@@ -0,0 +1,467 @@
+/*--------------------------------------------------------------------------------
+  Project:  SREEB - Simple Research Equipment Extension Box
+            Host (Linux) build
+  Module:   SREEB_test.cpp
+  Purpose:  Automated tests of the protocol (run by "ctest"); messages are fed
+            to the sketch via "Serial" and its replies are compared with the
+            expected ones. Covered are the incremental parser, the parameter
+            scanner, binary messages (COBS, CRC), tags, batches, the transmit
+            queue and streaming parameter handlers. Returns the number of
+            failed checks
+  Author:   Copyright (c) 2015 Thomas Euler, CIN University of Tübingen.
+            All right reserved.
+  History   v0.1 2026-10-17, file created
+  --------------------------------------------------------------------------------*/
+#include <Arduino.h>
+#include <RMsg.h>
+#include <string>
+#include <vector>
+
+#define   TEST_Loops         20    // passes of the main loop per command
+#define   TEST_ServoPort1    13    // pins of servo ports 1 and 2
+#define   TEST_ServoPort2    A0
+
+void      setup();
+void      loop();
+
+typedef std::vector<uint8_t>  Bytes_t;
+
+static int  nChecks, nFailed;
+
+//--------------------------------------------------------------------------------
+static void check (bool ok, const char* s, int line)
+{
+  nChecks += 1;
+  if (!ok) {
+    nFailed += 1;
+    fprintf(stderr, "FAILED (line %d): %s\n", line, s);
+  }
+}
+
+static void checkEqual (const std::string& got, const std::string& exp, int line)
+{
+  nChecks += 1;
+  if (got != exp) {
+    nFailed += 1;
+    fprintf(stderr, "FAILED (line %d):\n  expected \"%s\"\n  got      \"%s\"\n",
+            line, exp.c_str(), got.c_str());
+  }
+}
+
+#define CHECK(cond)          check((cond), #cond, __LINE__)
+#define CHECK_EQUAL(got,exp) checkEqual((got), (exp), __LINE__)
+
+//--------------------------------------------------------------------------------
+// Link to the sketch
+//--------------------------------------------------------------------------------
+static std::string readReplies (int nLoops)
+// Runs the main loop and returns everything the sketch sent meanwhile, with
+// the line ends removed
+{
+  std::string  s;
+  char         buf[256];
+  size_t       n;
+
+  for (int i = 0; i<nLoops; i++) {
+    loop();
+    while ((n = Serial.hostRead(buf, sizeof(buf))) > 0)
+      s.append(buf, n);
+  }
+  for (size_t i; (i = s.find("\r\n")) != std::string::npos; )
+    s.erase(i, 2);
+  return s;
+}
+
+static std::string send (const std::string& s, int nLoops = TEST_Loops)
+{
+  Serial.hostWrite((const uint8_t*)s.data(), s.size());
+  return readReplies(nLoops);
+}
+
+static std::string sendBytewise (const std::string& s)
+// Sends one byte per pass of the main loop
+{
+  std::string  r;
+
+  for (size_t i = 0; i<s.size(); i++) {
+    Serial.hostWrite((const uint8_t*)&s[i], 1);
+    r += readReplies(1);
+  }
+  return r +readReplies(TEST_Loops);
+}
+
+//--------------------------------------------------------------------------------
+// Binary messages (see RMsg.h)
+//--------------------------------------------------------------------------------
+static uint16_t crc16 (const Bytes_t& d)
+{
+  uint16_t  crc = 0xFFFF;
+
+  for (uint8_t b : d) {
+    crc ^= (uint16_t)b << 8;
+    for (int i = 0; i<8; i++)
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+  }
+  return crc;
+}
+
+static Bytes_t encodeFrame (const Bytes_t& payload)
+// Appends the CRC, COBS-encodes and terminates the payload
+{
+  Bytes_t  d = payload, out;
+  uint16_t crc = crc16(d);
+  size_t   iCode = 0;
+
+  d.push_back(crc & 0xFF);
+  d.push_back(crc >> 8);
+  out.push_back(1);
+  for (uint8_t b : d) {
+    if (b == 0) {
+      iCode = out.size();
+      out.push_back(1);
+    }
+    else {
+      out.push_back(b);
+      out[iCode] += 1;
+    }
+  }
+  out.push_back(0);
+  return out;
+}
+
+static Bytes_t binMsg (int tok, int tag,
+                       const std::vector<std::pair<char, std::vector<int> > >& params)
+{
+  Bytes_t  d;
+
+  d.push_back((uint8_t)(tok | ((tag >= 0) ? 0x80 : 0)));
+  if (tag >= 0)
+    d.push_back((uint8_t)tag);
+  for (const auto& p : params) {
+    d.push_back((uint8_t)p.first);
+    d.push_back((uint8_t)p.second.size());
+    for (int v : p.second) {
+      d.push_back(v & 0xFF);
+      d.push_back((v >> 8) & 0xFF);
+    }
+  }
+  return d;
+}
+
+static bool decodeFrame (const std::string& s, size_t* pos, Bytes_t* payload)
+// Decodes the next frame in "s" from "pos"; returns false if there is none or
+// if its CRC is wrong
+{
+  size_t   i = *pos, iEnd = s.find('\0', *pos);
+  Bytes_t  d;
+  uint16_t crc;
+
+  if (iEnd == std::string::npos)
+    return false;
+  *pos = iEnd +1;
+  while (i < iEnd) {
+    uint8_t code = (uint8_t)s[i++];
+    for (int k = 1; (k < code) && (i < iEnd); k++)
+      d.push_back((uint8_t)s[i++]);
+    if ((code < 0xFF) && (i < iEnd))
+      d.push_back(0);
+  }
+  if (d.size() < 3)
+    return false;
+  crc = d[d.size() -2] | (d[d.size() -1] << 8);
+  d.resize(d.size() -2);
+  *payload = d;
+  return crc16(d) == crc;
+}
+
+static std::string toStr (const Bytes_t& d)
+{
+  return std::string((const char*)d.data(), d.size());
+}
+
+static int valueAt (const Bytes_t& d, size_t i)
+{
+  return (int16_t)(d[i] | (d[i +1] << 8));
+}
+
+//================================================================================
+// Tests
+//--------------------------------------------------------------------------------
+static void testParser ()
+// Incremental parser (messages split at any byte, several per write)
+{
+  CHECK_EQUAL(sendBytewise(">SDM P=1,2 M=2,2;"), "<ACK C=7;");
+  CHECK_EQUAL(send(">SDV P=1 V=1;>SDV P=2 V=1;"), "<ACK C=8;<ACK C=8;");
+  CHECK(digitalRead(TEST_ServoPort1) == HIGH);
+  CHECK(digitalRead(TEST_ServoPort2) == HIGH);
+  CHECK_EQUAL(send("noise;>sdv p=1,2 v=0,0;"), "<ACK C=8;");
+  CHECK(digitalRead(TEST_ServoPort1) == LOW);
+  CHECK_EQUAL(send(">XYZ;"), "<ERR C=255 E=1,0;");
+}
+
+static void testScanner ()
+// Parameter scanner: decimal, hex word and byte formats, invalid values
+{
+  CHECK_EQUAL(send(">SDV P:00010002 V.0100;"), "<ACK C=8;");
+  CHECK(digitalRead(TEST_ServoPort1) == HIGH);
+  CHECK(digitalRead(TEST_ServoPort2) == LOW);
+  CHECK_EQUAL(send(">SDV P=1 V=-1;"), "<ERR C=8 E=3,1;");
+  CHECK_EQUAL(send(">SDV P=1 V=99999;"), "<ERR C=8 E=3,1;");
+  CHECK_EQUAL(send(">SDV P=1 V=1x;"), "<ERR C=8 E=4,11;");
+  CHECK_EQUAL(send(">SDV P=1,2 V=1;"), "<ERR C=255 E=3,0;");
+  CHECK_EQUAL(send(">SDV P=1 V=0;"), "<ACK C=8;");
+  CHECK(digitalRead(TEST_ServoPort1) == LOW);
+}
+
+static void testTags ()
+// Tags are echoed by the reply only, not by events sent meanwhile
+{
+  CHECK_EQUAL(send(">SDV#17 P=1 V=1;"), "<ACK#17 C=8;");
+  CHECK_EQUAL(send(">SDV#0 P=1 V=300;"), "<ERR#0 C=8 E=3,1;");
+  CHECK_EQUAL(send(">SDV#256 P=1 V=0;"), "<ERR C=8 E=4,7;");
+  CHECK_EQUAL(send(">SDV P=1 V=0;"), "<ACK C=8;");
+  CHECK(send(">VER#255;").compare(0, 14, "<VER#255 V=3 M") == 0);
+
+  CHECK_EQUAL(send(">SQA P=1 V=1 D=1000;"), "<ACK C=19;");
+  CHECK_EQUAL(send(">SQP#3 M=1;"), "<ACK#3 C=20;");
+  CHECK_EQUAL(send(">SQP#7 M=0;"), "<SQP N=0 S=1;<ACK#7 C=20;");
+  CHECK_EQUAL(send(">SQC#8;"), "<ACK#8 C=18;");
+  CHECK_EQUAL(send(">SDV P=1 V=0;"), "<ACK C=8;");
+}
+
+static void testBatch ()
+// Commands of a batch are applied together, with one reply
+{
+  std::string  r;
+
+  CHECK_EQUAL(send(">BEG;"), "");
+  CHECK_EQUAL(send(">SDV P=1 V=1;"), "");
+  CHECK_EQUAL(send(">SDV P=2 V=1;"), "");
+  CHECK(digitalRead(TEST_ServoPort1) == LOW);
+  CHECK_EQUAL(send(">END#4;"), "<ACK#4 C=16 R=0,0;");
+  CHECK(digitalRead(TEST_ServoPort1) == HIGH);
+  CHECK(digitalRead(TEST_ServoPort2) == HIGH);
+
+  // An invalid command rejects the batch, an invalid value does not
+  //
+  send(">BEG;");
+  send(">SDV P=1 V=0;");
+  send(">SDV P=1 V=0 X=1;");
+  CHECK_EQUAL(send(">END;"), "<ERR C=16 E=4,1 R=0,3;");
+  CHECK(digitalRead(TEST_ServoPort1) == HIGH);
+  send(">BEG;");
+  send(">SDV P=1 V=0;");
+  send(">SDV P=9 V=0;");
+  CHECK_EQUAL(send(">END;"), "<ERR C=16 E=3,1 R=0,3;");
+  CHECK(digitalRead(TEST_ServoPort1) == LOW);
+
+  // Too many values or commands
+  //
+  send(">BEG;");
+  for (int i = 0; i<3; i++)
+    send(">SDV P=1,2,3,4,5,6,7 V=0,0,0,0,0,0,0 T=100;");
+  CHECK_EQUAL(send(">SDV P=1,2,3,4,5,6,7 V=0,0,0,0,0,0,0 T=100;"), "");
+  CHECK_EQUAL(send(">END;"), "<ERR C=16 E=4,1 R=0,0,0,7;");
+  send(">BEG;");
+  for (int i = 0; i<7; i++)
+    send(">SDV P=2 V=0;");
+  CHECK_EQUAL(send(">END;"), "<ERR C=16 E=4,1 R=0,0,0,0,0,7;");
+  CHECK_EQUAL(send(">END;"), "<ERR C=16 E=4,0;");
+  CHECK(digitalRead(TEST_ServoPort2) == HIGH);
+
+  // Batched commands get no reply, so their tags must not be passed on to
+  // an event, like the report of lost samples
+  //
+  CHECK_EQUAL(send(">CLR;>SDM P=1 M=2;"), "<ACK C=10;<ACK C=7;");
+  CHECK_EQUAL(send(">REC R=1000,5;", 1), "<ACK C=13;");
+  CHECK_EQUAL(send(">BEG#8;", 1), "");
+  delay(100);
+  r = send(">SDV#9 P=1 V=0;", 1);
+  CHECK(r.compare(0, 15, "<ERR C=13 E=7,9") == 0);
+  r = send(">END;>REC R=0;");
+  CHECK(r.compare(0, 15, "<ACK C=16 R=0;<") == 0);
+  CHECK(r.find('#') == std::string::npos);
+  CHECK_EQUAL(send(">SDM P=1,2 M=2,2;"), "<ACK C=7;");
+}
+
+static void testBinary ()
+// Binary messages: COBS framing, CRC, tags and switching back to ASCII
+{
+  std::string  r;
+  Bytes_t      d, f;
+  size_t       pos = 0;
+
+  CHECK_EQUAL(send(">BIN M=1;"), "<ACK C=6;");
+
+  f = encodeFrame(binMsg(TOK_SDV, 9, {{'P', {1, 2}}, {'V', {0, 0}}}));
+  r = send(toStr(f));
+  CHECK(decodeFrame(r, &pos, &d));
+  CHECK(d == binMsg(TOK_ACK, 9, {{'C', {TOK_SDV}}}));
+  CHECK(pos == r.size());
+  CHECK(digitalRead(TEST_ServoPort1) == LOW);
+  CHECK(digitalRead(TEST_ServoPort2) == LOW);
+
+  // Frame with a value that contains zero bytes and a wrong CRC
+  //
+  f = encodeFrame(binMsg(TOK_SDV, -1, {{'P', {1}}, {'V', {256}}}));
+  pos = 0;
+  CHECK(decodeFrame(send(toStr(f)), &pos, &d));
+  CHECK(d == binMsg(TOK_ERR, -1, {{'C', {TOK_SDV}}, {'E', {ERR_AtLeastOneInvalidParam, 1}}}));
+  f[f.size() -2] ^= 0x01;
+  pos = 0;
+  CHECK(decodeFrame(send(toStr(f)), &pos, &d));
+  CHECK((d.size() == 11) && (d[0] == TOK_ERR) && (valueAt(d, 7) == ERR_ChecksumError));
+
+  pos = 0;
+  r = send(toStr(encodeFrame(binMsg(TOK_VER, -1, {}))));
+  CHECK(decodeFrame(r, &pos, &d));
+  CHECK((d.size() == 9) && (d[0] == TOK_VER) && (d[1] == 'V') && (d[5] == 'M'));
+
+  pos = 0;
+  r = send(toStr(encodeFrame(binMsg(TOK_BIN, -1, {{'M', {0}}}))));
+  CHECK(decodeFrame(r, &pos, &d));
+  CHECK(d == binMsg(TOK_ACK, -1, {{'C', {TOK_BIN}}}));
+  CHECK_EQUAL(send(">SDV P=1 V=0;"), "<ACK C=8;");
+}
+
+static void testTxQueue ()
+// Replies are passed to a slow link without loss; remarks that do not fit
+// into the queue are dropped and counted
+{
+  RMsgT<32, 64, 80>  obj;
+  std::string        r, rem(20, 'x');
+  char               buf[256];
+  size_t             n;
+
+  Serial.hostSetTxBufLen(8);
+  CHECK(send(">STA#1;").compare(0, 7, "<STA#1 ") == 0);
+
+  // Each remark takes 28 bytes; with 8 bytes free in the UART and 80 in the
+  // queue, three fit and the fourth is dropped
+  //
+  obj.setStream(&Serial, NULL);
+  for (int i = 0; i<4; i++)
+    obj.sendRemMsg((char*)rem.c_str());
+  CHECK(obj.getStats()->nTxDropped == 1);
+  r.clear();
+  for (int i = 0; i<100; i++) {
+    obj.updateTx();
+    while ((n = Serial.hostRead(buf, sizeof(buf))) > 0)
+      r.append(buf, n);
+  }
+  CHECK_EQUAL(r, "<REM " +rem +";\r\n<REM " +rem +";\r\n<REM " +rem +";\r\n"
+                 "<REM 1 dropped;\r\n");
+  Serial.hostSetTxBufLen(HOST_SerialBufLen);
+}
+
+static long         hdlSum;
+static int          hdlNValues;
+static std::string  hdlKeys, hdlEnds;
+
+static bool handleSDV (byte event, char key, int val)
+// Adds up the values of a streamed message, rejects the parameter 'X'
+{
+  switch (event) {
+    case MSG_Hdl_Begin :
+      hdlSum     = 0;
+      hdlNValues = 0;
+      hdlKeys.clear();
+      break;
+    case MSG_Hdl_Param :
+      hdlKeys += key;
+      return (key != 'X');
+    case MSG_Hdl_Value :
+      hdlSum     += val;
+      hdlNValues += 1;
+      break;
+    case MSG_Hdl_End :
+      hdlEnds += std::to_string(val);
+      break;
+  }
+  return true;
+}
+
+static std::string sendToHandler (RMsgClass* obj, const std::string& s, size_t chunk)
+// Sends "s" in chunks of "chunk" bytes, reads after each chunk and acknowledges
+// the messages that are passed on; returns the replies
+{
+  Msg_t        msg;
+  token_t      tok;
+  std::string  r;
+  char         buf[256];
+  size_t       n;
+
+  for (size_t i = 0; i<s.size(); i += chunk) {
+    Serial.hostWrite((const uint8_t*)s.data() +i, std::min(chunk, s.size() -i));
+    if ((tok = obj->readMsgFromStream(&msg)) != TOK_NONE)
+      obj->sendConfirmMsg(tok, ERR_None, 0);
+  }
+  while ((n = Serial.hostRead(buf, sizeof(buf))) > 0)
+    r.append(buf, n);
+  for (size_t i; (i = r.find("\r\n")) != std::string::npos; )
+    r.erase(i, 2);
+  return r;
+}
+
+static void testHandler ()
+// Streaming parameter handler: the values are passed on while they arrive,
+// so that a message can carry more values than fit into the input buffer
+{
+  RMsgClass    obj;
+  std::string  s = ">SDV#12 A=";
+  Bytes_t      f, d;
+  size_t       pos = 0;
+
+  obj.setStream(&Serial, NULL);
+  CHECK(obj.setHandler(TOK_SDV, handleSDV));
+  for (int i = 0; i<=500; i++)
+    s += std::to_string(i) +((i < 500) ? "," : " B:FFFF0002;");
+  CHECK_EQUAL(sendToHandler(&obj, s, 7), "<ACK#12 C=8;");
+  CHECK((hdlNValues == 503) && (hdlSum == 125250 +1) && (hdlKeys == "AB"));
+  CHECK_EQUAL(hdlEnds, "0");
+
+  // Rejected by the handler, invalid value, cut off by the next message
+  //
+  hdlEnds.clear();
+  CHECK_EQUAL(sendToHandler(&obj, ">SDV#5 A=1 X=2;", 4), "<ERR#5 C=8 E=4,10;");
+  CHECK_EQUAL(sendToHandler(&obj, ">SDV A=1,b;", 4), "<ERR C=8 E=4,8;");
+  CHECK_EQUAL(sendToHandler(&obj, ">SDV A=1,2 >SDV A=5;", 4), "<ACK C=8;");
+  CHECK((hdlNValues == 1) && (hdlSum == 5));
+  CHECK_EQUAL(hdlEnds, "4440");
+
+  // Other tokens are not passed on
+  //
+  hdlEnds.clear();
+  CHECK_EQUAL(sendToHandler(&obj, ">SDM P=1 M=2;", 3), "<ACK C=7;");
+  CHECK(hdlEnds.empty());
+
+  // Binary messages are passed on after the checksum has been verified
+  //
+  obj.setBinaryMode(true);
+  f = encodeFrame(binMsg(TOK_SDV, 9, {{'A', {1, 2, 3}}, {'B', {-4}}}));
+  hdlEnds.clear();
+  s = sendToHandler(&obj, toStr(f), 3);
+  CHECK((hdlNValues == 4) && (hdlSum == 2) && (hdlKeys == "AB"));
+  CHECK_EQUAL(hdlEnds, "0");
+  CHECK(decodeFrame(s, &pos, &d));
+  CHECK(d == binMsg(TOK_ACK, 9, {{'C', {TOK_SDV}}}));
+  obj.setHandler(TOK_SDV, NULL);
+}
+
+//================================================================================
+int main ()
+{
+  setup();
+  readReplies(TEST_Loops);
+
+  testParser();
+  testScanner();
+  testTags();
+  testBatch();
+  testBinary();
+  testTxQueue();
+  testHandler();
+
+  printf("%d checks, %d failed\n", nChecks, nFailed);
+  return (nFailed > 0) ? 1 : 0;
+}
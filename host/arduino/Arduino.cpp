@@ -0,0 +1,286 @@
+/*--------------------------------------------------------------------------------
+  Project:  SREEB - Simple Research Equipment Extension Box
+            Host (Linux) build
+  Module:   Arduino.cpp
+  Purpose:  Stand-in for the Arduino core (see Arduino.h)
+  Author:   Copyright (c) 2015 Thomas Euler, CIN University of Tübingen.
+            All right reserved.
+  History   v0.1 2026-10-17, file created
+  --------------------------------------------------------------------------------*/
+#include <time.h>
+#include <ctype.h>
+#include "Arduino.h"
+#include "Servo.h"
+
+//--------------------------------------------------------------------------------
+// Pin model
+//--------------------------------------------------------------------------------
+volatile uint8_t HOST_PORT[HOST_nPorts];
+volatile uint8_t HOST_PIN[HOST_nPorts];
+volatile uint8_t HOST_DDR[HOST_nPorts];
+static uint8_t   pinModes[NUM_DIGITAL_PINS];
+static int       pinAnalog[NUM_DIGITAL_PINS];
+
+void pinMode (uint8_t pin, uint8_t mode)
+{
+  if (pin >= NUM_DIGITAL_PINS)
+    return;
+  pinModes[pin] = mode;
+  if (mode == OUTPUT)
+    HOST_DDR[pin /8] |= _BV(pin %8);
+  else
+    HOST_DDR[pin /8] &= ~_BV(pin %8);
+}
+
+void digitalWrite (uint8_t pin, uint8_t val)
+{
+  if (pin >= NUM_DIGITAL_PINS)
+    return;
+  if (val != LOW)
+    HOST_PORT[pin /8] |= _BV(pin %8);
+  else
+    HOST_PORT[pin /8] &= ~_BV(pin %8);
+}
+
+int digitalRead (uint8_t pin)
+{
+  if (pin >= NUM_DIGITAL_PINS)
+    return LOW;
+  if (HOST_DDR[pin /8] & _BV(pin %8))
+    return (HOST_PORT[pin /8] & _BV(pin %8)) ? HIGH : LOW;
+  return (HOST_PIN[pin /8] & _BV(pin %8)) ? HIGH : LOW;
+}
+
+int  analogRead (uint8_t pin)
+{
+  if (pin < A0)
+    pin += A0;
+  return (pin < NUM_DIGITAL_PINS) ? pinAnalog[pin] : 0;
+}
+
+void analogReference (uint8_t mode) { (void)mode; }
+void analogWrite (uint8_t pin, int val) { digitalWrite(pin, (val > 127) ? HIGH : LOW); }
+
+void HOST_setPinInput (uint8_t pin, uint8_t val)
+{
+  if (pin >= NUM_DIGITAL_PINS)
+    return;
+  if (val != LOW)
+    HOST_PIN[pin /8] |= _BV(pin %8);
+  else
+    HOST_PIN[pin /8] &= ~_BV(pin %8);
+}
+
+uint8_t HOST_getPinOutput (uint8_t pin)
+{
+  if (pin >= NUM_DIGITAL_PINS)
+    return LOW;
+  return (HOST_PORT[pin /8] & _BV(pin %8)) ? HIGH : LOW;
+}
+
+uint8_t HOST_getPinMode (uint8_t pin)
+{
+  return (pin < NUM_DIGITAL_PINS) ? pinModes[pin] : INPUT;
+}
+
+void HOST_setAnalogInput (uint8_t pin, int val)
+{
+  if (pin < NUM_DIGITAL_PINS)
+    pinAnalog[pin] = val;
+}
+
+//--------------------------------------------------------------------------------
+// Servos
+//--------------------------------------------------------------------------------
+static int       servoValues[NUM_DIGITAL_PINS];
+static bool      isServoValuesInit = false;
+
+void HOST_recordServoValue (int pin, int value)
+{
+  if ((pin < 0) || (pin >= NUM_DIGITAL_PINS))
+    return;
+  HOST_getServoValue(0);
+  servoValues[pin] = value;
+}
+
+int  HOST_getServoValue (int pin)
+{
+  if (!isServoValuesInit) {
+    for (int i = 0; i<NUM_DIGITAL_PINS; i++)
+      servoValues[i] = -1;
+    isServoValuesInit = true;
+  }
+  return ((pin >= 0) && (pin < NUM_DIGITAL_PINS)) ? servoValues[pin] : -1;
+}
+
+//--------------------------------------------------------------------------------
+// Clock; either real (monotonic) time or a simulated clock advanced by the host
+//--------------------------------------------------------------------------------
+static bool           isRealTimeClock = true;
+static unsigned long  simClock_us     = 0;
+
+static unsigned long long realTime_us ()
+{
+  static unsigned long long t0 = 0;
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  unsigned long long t = (unsigned long long)ts.tv_sec*1000000ULL +ts.tv_nsec/1000;
+  if (t0 == 0)
+    t0 = t;
+  return t -t0;
+}
+
+unsigned long micros ()
+{
+  if (isRealTimeClock)
+    return (unsigned long)(uint32_t)realTime_us();
+  return (unsigned long)(uint32_t)simClock_us;
+}
+
+unsigned long millis ()
+{
+  if (isRealTimeClock)
+    return (unsigned long)(uint32_t)(realTime_us() /1000);
+  return (unsigned long)(uint32_t)(simClock_us /1000);
+}
+
+void delayMicroseconds (unsigned int us)
+{
+  if (isRealTimeClock) {
+    unsigned long long t = realTime_us() +us;
+    while (realTime_us() < t);
+  }
+  else
+    simClock_us += us;
+}
+
+void delay (unsigned long ms)
+{
+  if (isRealTimeClock) {
+    struct timespec ts = {(time_t)(ms /1000), (long)(ms %1000) *1000000L};
+    nanosleep(&ts, NULL);
+  }
+  else
+    simClock_us += ms *1000;
+}
+
+void HOST_advanceClock_us (unsigned long us) { simClock_us += us; }
+void HOST_setRealTime (bool isRealTime)     { isRealTimeClock = isRealTime; }
+
+//--------------------------------------------------------------------------------
+// AVR libc extensions
+//--------------------------------------------------------------------------------
+char* itoa (int value, char *str, int base)
+{
+  if (base == 16)
+    sprintf(str, "%x", (unsigned int)value);
+  else
+    sprintf(str, "%d", value);
+  return str;
+}
+
+char* strupr (char *s)
+{
+  for (char *p = s; *p; p++)
+    *p = toupper((unsigned char)*p);
+  return s;
+}
+
+//--------------------------------------------------------------------------------
+// Serial port
+//--------------------------------------------------------------------------------
+HostSerial::HostSerial ()
+{
+  baud       = 0;
+  nTxBytes   = 0;
+  txBufLen   = HOST_SerialBufLen;
+  txFullHook = NULL;
+  hostClear();
+}
+
+void   HostSerial::begin (unsigned long _baud) { baud = _baud; }
+
+int    HostSerial::available ()
+{
+  return (int)(rxHead -rxTail);
+}
+
+int    HostSerial::read ()
+{
+  if (rxHead == rxTail)
+    return -1;
+  return rxBuf[rxTail++ %HOST_SerialBufLen];
+}
+
+int    HostSerial::peek ()
+{
+  if (rxHead == rxTail)
+    return -1;
+  return rxBuf[rxTail %HOST_SerialBufLen];
+}
+
+size_t HostSerial::write (uint8_t b)
+{
+  while ((txHead -txTail) >= txBufLen) {
+    if (txFullHook == NULL)
+      txTail += 1;
+    else
+      txFullHook();
+  }
+  txBuf[txHead++ %HOST_SerialBufLen] = b;
+  nTxBytes += 1;
+  return 1;
+}
+
+int    HostSerial::availableForWrite ()
+{
+  return (int)(txBufLen -(txHead -txTail));
+}
+
+void   HostSerial::hostWrite (const uint8_t *buf, size_t n)
+{
+  while (n-- && (rxHead -rxTail < HOST_SerialBufLen))
+    rxBuf[rxHead++ %HOST_SerialBufLen] = *buf++;
+}
+
+void   HostSerial::hostWrite (const char *s)
+{
+  hostWrite((const uint8_t*)s, strlen(s));
+}
+
+size_t HostSerial::hostRead (char *buf, size_t n)
+{
+  size_t k = 0;
+  while ((k < n) && (txTail != txHead))
+    buf[k++] = txBuf[txTail++ %HOST_SerialBufLen];
+  return k;
+}
+
+size_t HostSerial::hostAvailable ()
+{
+  return txHead -txTail;
+}
+
+void   HostSerial::hostSetTxBufLen (size_t n)
+{
+  txBufLen = ((n > 0) && (n <= HOST_SerialBufLen)) ? n : HOST_SerialBufLen;
+}
+
+void   HostSerial::hostSetTxFullHook (void (*hook)())
+{
+  txFullHook = hook;
+}
+
+void   HostSerial::hostClear ()
+{
+  rxHead = rxTail = 0;
+  txHead = txTail = 0;
+}
+
+HostSerial Serial;
+
+//--------------------------------------------------------------------------------
+// Linker symbols of the AVR memory layout
+//--------------------------------------------------------------------------------
+int   __bss_end;
+int  *__brkval = 0;
@@ -0,0 +1,144 @@
+/*--------------------------------------------------------------------------------
+  Project:  SREEB - Simple Research Equipment Extension Box
+            Host (Linux) build
+  Module:   Arduino.h
+  Purpose:  Stand-in for <Arduino.h>; provides the subset of the Arduino core
+            used by SREEB and its libraries, backed by an in-memory pin model,
+            a host clock and an in-memory serial port ("Serial")
+  Author:   Copyright (c) 2015 Thomas Euler, CIN University of Tübingen.
+            All right reserved.
+  History   v0.1 2026-10-17, file created
+  --------------------------------------------------------------------------------*/
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "avr/pgmspace.h"
+#include "Print.h"
+#include "Stream.h"
+
+typedef uint8_t  byte;
+typedef bool     boolean;
+typedef uint16_t word;
+
+#define HIGH            0x1
+#define LOW             0x0
+#define INPUT           0x0
+#define OUTPUT          0x1
+#define INPUT_PULLUP    0x2
+
+#define DEFAULT         1
+#define EXTERNAL        0
+#define INTERNAL        3
+
+// Pin numbering of the ATmega32U4 (Leonardo) variant
+#define NUM_DIGITAL_PINS 31
+#define A0              18
+#define A1              19
+#define A2              20
+#define A3              21
+#define A4              22
+#define A5              23
+#define A6              24
+#define A7              25
+
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+
+#define noInterrupts()
+#define interrupts()
+#define _BV(bit)        (1 << (bit))
+#define lowByte(w)      ((uint8_t)((w) & 0xff))
+#define highByte(w)     ((uint8_t)((w) >> 8))
+
+// Simulated I/O ports: pin n is bit (n %8) of port (n /8)
+#define HOST_nPorts     ((NUM_DIGITAL_PINS +7) /8)
+extern volatile uint8_t HOST_PORT[HOST_nPorts];
+extern volatile uint8_t HOST_PIN[HOST_nPorts];
+extern volatile uint8_t HOST_DDR[HOST_nPorts];
+
+#define NOT_A_PORT                0
+#define digitalPinToPort(P)       ((uint8_t)((P) /8 +1))
+#define digitalPinToBitMask(P)    ((uint8_t)_BV((P) %8))
+#define portOutputRegister(P)     (&HOST_PORT[(P) -1])
+#define portInputRegister(P)      (&HOST_PIN[(P) -1])
+#define portModeRegister(P)       (&HOST_DDR[(P) -1])
+
+void           pinMode(uint8_t pin, uint8_t mode);
+void           digitalWrite(uint8_t pin, uint8_t val);
+int            digitalRead(uint8_t pin);
+int            analogRead(uint8_t pin);
+void           analogReference(uint8_t mode);
+void           analogWrite(uint8_t pin, int val);
+
+unsigned long  millis();
+unsigned long  micros();
+void           delay(unsigned long ms);
+void           delayMicroseconds(unsigned int us);
+
+char*          itoa(int value, char *str, int base);
+char*          strupr(char *s);
+
+//--------------------------------------------------------------------------------
+// Serial port, backed by in-memory buffers
+//--------------------------------------------------------------------------------
+#define HOST_SerialBufLen  4096
+
+class HostSerial : public Stream
+{
+  public:
+    HostSerial();
+    void    begin(unsigned long baud);
+    void    end() {}
+    operator bool() { return true; }
+
+    virtual int    available();
+    virtual int    read();
+    virtual int    peek();
+    virtual size_t write(uint8_t b);
+    using Print::write;
+    virtual int    availableForWrite();
+
+    // Host side of the link
+    void    hostWrite(const char *s);
+    void    hostWrite(const uint8_t *buf, size_t n);
+    size_t  hostRead(char *buf, size_t n);
+    size_t  hostAvailable();
+    void    hostClear();
+
+    // Size of the transmit buffer (<= HOST_SerialBufLen) and what happens if
+    // it is full: without a hook, the oldest byte is overwritten; otherwise,
+    // "write" waits like on the board, calling the hook until it has read
+    // some bytes (see "hostRead")
+    void    hostSetTxBufLen(size_t n);
+    void    hostSetTxFullHook(void (*hook)());
+
+    unsigned long  baud;
+    unsigned long  nTxBytes;
+
+  private:
+    uint8_t rxBuf[HOST_SerialBufLen];
+    size_t  rxHead, rxTail;
+    uint8_t txBuf[HOST_SerialBufLen];
+    size_t  txHead, txTail, txBufLen;
+    void    (*txFullHook)();
+};
+
+extern HostSerial Serial;
+
+//--------------------------------------------------------------------------------
+// Host-side access to the simulated hardware
+//--------------------------------------------------------------------------------
+void           HOST_setPinInput(uint8_t pin, uint8_t val);
+uint8_t        HOST_getPinOutput(uint8_t pin);
+uint8_t        HOST_getPinMode(uint8_t pin);
+void           HOST_setAnalogInput(uint8_t pin, int val);
+void           HOST_advanceClock_us(unsigned long us);
+void           HOST_setRealTime(bool isRealTime);
+
+#endif
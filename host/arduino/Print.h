@@ -0,0 +1,55 @@
+/*--------------------------------------------------------------------------------
+  Project:  SREEB - Simple Research Equipment Extension Box
+            Host (Linux) build
+  Module:   Print.h
+  Purpose:  Stand-in for the Arduino "Print" class (base of "RString")
+  Author:   Copyright (c) 2015 Thomas Euler, CIN University of Tübingen.
+            All right reserved.
+  History   v0.1 2026-10-17, file created
+  --------------------------------------------------------------------------------*/
+#ifndef Print_h
+#define Print_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+
+#define DEC 10
+#define HEX 16
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+
+class Print
+{
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t) = 0;
+    virtual size_t write(const uint8_t *buf, size_t n)
+    { size_t k = 0; while (n--) k += write(*buf++); return k; }
+    virtual int    availableForWrite() { return 0; }
+
+    size_t write(const char *s)
+    { return (s == NULL) ? 0 : write((const uint8_t*)s, strlen(s)); }
+    size_t write(const char *buf, size_t n)
+    { return write((const uint8_t*)buf, n); }
+
+    size_t print(const __FlashStringHelper *s) { return write((const char*)s); }
+    size_t print(const char s[])               { return write(s); }
+    size_t print(char c)                       { return write((uint8_t)c); }
+    size_t print(unsigned char n, int base = DEC) { return print((unsigned long)n, base); }
+    size_t print(int n, int base = DEC)           { return print((long)n, base); }
+    size_t print(unsigned int n, int base = DEC)  { return print((unsigned long)n, base); }
+    size_t print(long n, int base = DEC)
+    { char b[24]; snprintf(b, sizeof(b), (base == HEX) ? "%lX" : "%ld", n); return write(b); }
+    size_t print(unsigned long n, int base = DEC)
+    { char b[24]; snprintf(b, sizeof(b), (base == HEX) ? "%lX" : "%lu", n); return write(b); }
+    size_t print(double n, int digits = 2)
+    { char b[32]; snprintf(b, sizeof(b), "%.*f", digits, n); return write(b); }
+
+    size_t println()                           { return write("\r\n"); }
+    template<class T> size_t println(T arg)    { size_t k = print(arg); return k +println(); }
+};
+
+#endif
@@ -0,0 +1,36 @@
+/*--------------------------------------------------------------------------------
+  Project:  SREEB - Simple Research Equipment Extension Box
+            Host (Linux) build
+  Module:   Servo.h
+  Purpose:  Stand-in for the Arduino Servo library; records the values written
+            to each pin (see HOST_getServoValue)
+  Author:   Copyright (c) 2015 Thomas Euler, CIN University of Tübingen.
+            All right reserved.
+  History   v0.1 2026-10-17, file created
+  --------------------------------------------------------------------------------*/
+#ifndef Servo_h
+#define Servo_h
+
+#include <stdint.h>
+
+// Last value written to a servo attached to the pin (-1, never written)
+void    HOST_recordServoValue(int pin, int value);
+int     HOST_getServoValue(int pin);
+
+class Servo
+{
+  public:
+    Servo() : pin(-1), value(-1), nWrites(0) {}
+    uint8_t attach(int _pin)        { pin = _pin; return 0; }
+    void    detach()                { pin = -1; }
+    bool    attached()              { return pin >= 0; }
+    void    write(int _value)       { value = _value; nWrites += 1; 
+                                      HOST_recordServoValue(pin, value); }
+    int     read()                  { return value; }
+
+    int           pin;
+    int           value;
+    unsigned long nWrites;
+};
+
+#endif
@@ -0,0 +1,42 @@
+/*--------------------------------------------------------------------------------
+  Project:  SREEB - Simple Research Equipment Extension Box
+            Host (Linux) build
+  Module:   Stream.h
+  Purpose:  Stand-in for the Arduino "Stream" class
+  Author:   Copyright (c) 2015 Thomas Euler, CIN University of Tübingen.
+            All right reserved.
+  History   v0.1 2026-10-17, file created
+  --------------------------------------------------------------------------------*/
+#ifndef Stream_h
+#define Stream_h
+
+#include "Print.h"
+
+class Stream : public Print
+{
+  public:
+    Stream() : _timeout(1000) {}
+    virtual int  available() = 0;
+    virtual int  read() = 0;
+    virtual int  peek() = 0;
+    virtual void flush() {}
+
+    void   setTimeout(unsigned long timeout) { _timeout = timeout; }
+    size_t readBytesUntil(char terminator, char *buffer, size_t length)
+    {
+      // No time-out on the host; reads only what is already available
+      size_t n = 0;
+      while ((n < length) && (available() > 0)) {
+        int c = read();
+        if (c == terminator)
+          break;
+        buffer[n++] = (char)c;
+      }
+      return n;
+    }
+
+  protected:
+    unsigned long _timeout;
+};
+
+#endif
@@ -0,0 +1,33 @@
+/*--------------------------------------------------------------------------------
+  Project:  SREEB - Simple Research Equipment Extension Box
+            Host (Linux) build
+  Module:   pgmspace.h
+  Purpose:  Stand-in for <avr/pgmspace.h>; "flash" is ordinary memory on
+            the host
+  Author:   Copyright (c) 2015 Thomas Euler, CIN University of Tübingen.
+            All right reserved.
+  History   v0.1 2026-10-17, file created
+  --------------------------------------------------------------------------------*/
+#ifndef pgmspace_h
+#define pgmspace_h
+
+#include <string.h>
+#include <stdio.h>
+
+#define PROGMEM
+#define PGM_P                 const char *
+#define PSTR(s)               (s)
+#define pgm_read_byte(addr)   (*(const unsigned char *)(addr))
+#define pgm_read_word(addr)   (*(addr))
+#define pgm_read_ptr(addr)    (*(addr))
+#define strcpy_P              strcpy
+#define strncpy_P             strncpy
+#define strlen_P              strlen
+#define strcmp_P              strcmp
+#define strcasecmp_P          strcasecmp
+#define strncasecmp_P         strncasecmp
+#define memcpy_P              memcpy
+#define sprintf_P             sprintf
+#define snprintf_P            snprintf
+
+#endif
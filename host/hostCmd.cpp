@@ -0,0 +1,57 @@
+/*--------------------------------------------------------------------------------
+  Project:  SREEB - Simple Research Equipment Extension Box
+            Host (Linux) build
+  Module:   hostCmd.cpp
+  Purpose:  Commands to control the simulated hardware (see hostCmd.h)
+  Author:   Copyright (c) 2015 Thomas Euler, CIN University of Tübingen.
+            All right reserved.
+  History   v0.1 2026-10-17, file created
+  --------------------------------------------------------------------------------*/
+#include <Arduino.h>
+#include "Servo.h"
+#include "hostCmd.h"
+
+void      loop();
+
+//--------------------------------------------------------------------------------
+static void sendHex (const char* s)
+{
+  unsigned int  v;
+  uint8_t       b;
+  int           n;
+
+  while (sscanf(s, " %2x%n", &v, &n) == 1) {
+    b  = (uint8_t)v;
+    Serial.hostWrite(&b, 1);
+    s += n;
+  }
+}
+
+//--------------------------------------------------------------------------------
+bool HOST_handleCmd (const char* s, FILE* out)
+{
+  int  p, v;
+
+  if (sscanf(s, "!pin %d %d", &p, &v) == 2)
+    HOST_setPinInput(p, v);
+  else if (sscanf(s, "!analog %d %d", &p, &v) == 2)
+    HOST_setAnalogInput(p, v);
+  else if (sscanf(s, "!out %d", &p) == 1)
+    fprintf(out, "!out %d %d\n", p, HOST_getPinOutput(p));
+  else if (sscanf(s, "!servo %d", &p) == 1)
+    fprintf(out, "!servo %d %d\n", p, HOST_getServoValue(p));
+  else if (sscanf(s, "!loop %d", &v) == 1) {
+    for (int i = 0; i<v; i++) {
+      loop();
+      delay(1);
+    }
+  }
+  else if (sscanf(s, "!delay %d", &v) == 1)
+    delay(v);
+  else if (strncmp(s, "!hex ", 5) == 0)
+    sendHex(s +5);
+  else
+    return false;
+  fflush(out);
+  return true;
+}
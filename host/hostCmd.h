@@ -0,0 +1,29 @@
+/*--------------------------------------------------------------------------------
+  Project:  SREEB - Simple Research Equipment Extension Box
+            Host (Linux) build
+  Module:   hostCmd.h
+  Purpose:  Commands to control the simulated hardware, shared by the host
+            programs; a command is a line starting with '!':
+              !pin p v     set digital input pin p to v (0/1)
+              !analog p v  set analog input pin p to v (0..1023)
+              !out p       print state of output pin p
+              !servo p     print last value written to the servo at pin p
+              !loop n      run the main loop n times, 1 ms apart
+              !delay ms    wait without running the main loop (stall)
+              !hex bytes   send bytes given as hex digits (binary messages)
+  Author:   Copyright (c) 2015 Thomas Euler, CIN University of Tübingen.
+            All right reserved.
+  History   v0.1 2026-10-17, file created
+  --------------------------------------------------------------------------------*/
+#ifndef hostCmd_h
+#define hostCmd_h
+
+#include <stdio.h>
+
+#define   HOST_CmdChr        '!'
+
+// Handles a command line; replies are written to "out". Returns false, if the
+// command was not recognized
+bool      HOST_handleCmd(const char* s, FILE* out);
+
+#endif
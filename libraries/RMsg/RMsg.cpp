@@ -22,31 +22,216 @@
   History:  see header 
   --------------------------------------------------------------------------------*/
 #include <Stream.h>
+#include <ctype.h>
 #include "RMsg.h"
 #include "RString.h"
   
 #include "RMsg_RESOURCES.h"
 
+#if defined(__AVR__)
+  #include <util/crc16.h>
+#endif
+
+//--------------------------------------------------------------------------------
+// Token lookup: a perfect hash of the three (upper case) token characters, 
+// generated by the compiler from "msgTokens"; each slot of the table holds the
+// index of the token with that hash or TOK_NONE
+//--------------------------------------------------------------------------------
+constexpr byte tokUpper (char c)
+{
+  return ((c >= 'a') && (c <= 'z')) ? (byte)(c -'a' +'A') : (byte)c;
+}
+
+constexpr byte tokHash (char c0, char c1, char c2)
+{
+  return (byte)((byte)((byte)(tokUpper(c0) *TOK_HashSeed) ^ tokUpper(c1)) 
+                *TOK_HashSeed ^ tokUpper(c2)) & (TOK_HashSize -1);
+}
+
+constexpr byte tokHashOf (int j)
+{
+  return tokHash(msgTokens[j][0], msgTokens[j][1], msgTokens[j][2]);
+}
+
+constexpr byte tokInSlot (int slot, int j)
+{
+  return (j > TOK_LastIndex) ? TOK_NONE : 
+         ((tokHashOf(j) == slot) ? j : tokInSlot(slot, j +1));
+}
+
+// Collisions are counted by two separate recursions (over the tokens and 
+// over the tokens after each), so that the recursion depth only grows 
+// linearly with the number of tokens (GCC's limit is 512 by default)
+//
+constexpr int  tokCollisionsWith (int j, int k)
+{
+  return (k > TOK_LastIndex) ? 0 : 
+         ((tokHashOf(j) == tokHashOf(k)) +tokCollisionsWith(j, k +1));
+}
+
+constexpr int  tokCollisions (int j)
+{
+  return (j >= TOK_LastIndex) ? 0 : 
+         (tokCollisionsWith(j, j +1) +tokCollisions(j +1));
+}
+
+static_assert(TOK_HashSize == 64, "Token hash table is generated for 64 slots");
+static_assert(tokCollisions(0) == 0, 
+              "Token hash collision, change TOK_HashSeed in RMsg_DEFINITIONS.h");
+
+//--------------------------------------------------------------------------------
+// Hex digit decoding for the word and byte formats; table starts with '0' and
+// ends with 'f', invalid characters map to HEX_Invalid
+//--------------------------------------------------------------------------------
+#define HEX_Invalid     0xFF
+#define HEX_x           HEX_Invalid
+
+const byte hexNibbles[] PROGMEM 
+                = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9,                  // '0'..'9'
+                   HEX_x, HEX_x, HEX_x, HEX_x, HEX_x, HEX_x, HEX_x,  // ':'..'@'
+                   10, 11, 12, 13, 14, 15,                        // 'A'..'F'
+                   HEX_x, HEX_x, HEX_x, HEX_x, HEX_x, HEX_x, HEX_x,  // 'G'..'`'
+                   HEX_x, HEX_x, HEX_x, HEX_x, HEX_x, HEX_x, HEX_x,
+                   HEX_x, HEX_x, HEX_x, HEX_x, HEX_x, HEX_x, HEX_x,
+                   HEX_x, HEX_x, HEX_x, HEX_x, HEX_x,
+                   10, 11, 12, 13, 14, 15};                       // 'a'..'f'
+
+static_assert(sizeof(hexNibbles) == ('f' -'0' +1), "Hex digit table incomplete");
+
+static inline void countUp (word* n)
+{
+  if (*n < 0xFFFF)
+    *n += 1;
+}
+
+static inline byte hexNibble (char ch)
+{
+  byte i = (byte)(ch -'0');
+  return (i < sizeof(hexNibbles)) ? pgm_read_byte(&hexNibbles[i]) : HEX_Invalid;
+}
+
+//--------------------------------------------------------------------------------
+// Number formatting for outgoing messages; the digits are written directly to
+// the output buffer, decimal digits are found by subtracting powers of ten, 
+// which is much faster on the AVR than dividing
+//--------------------------------------------------------------------------------
+#define MSG_MaxDecChars 7               // sign, 5 digits and separator
+
+const word decPowers[] PROGMEM = {10000, 1000, 100, 10};
+
+static byte formatDec (char* pOut, int val)
+{
+  char  *p   = pOut;
+  word  uVal = (word)val;
+  word  pow10;
+  char  digit;
+  bool  isLeading = true;
+
+  if ((int16_t)uVal < 0) {
+    *p++ = '-';
+    uVal = -uVal;
+  }
+  for(byte i=0; i<4; i+=1) {
+    pow10 = pgm_read_word(&decPowers[i]);
+    digit = '0';
+    while (uVal >= pow10) {
+      uVal  -= pow10;
+      digit += 1;
+    }
+    if ((digit != '0') || !isLeading) {
+      *p++      = digit;
+      isLeading = false;
+    }
+  }
+  *p++ = '0' +uVal;
+  return p -pOut;
+}
+
+static void formatHex (char* pOut, word val, byte nDigits)
+{
+  byte  nib;
+
+  while (nDigits > 0) {
+    nDigits -= 1;
+    nib      = val & 0x0F;
+    pOut[nDigits] = (nib < 10) ? ('0' +nib) : ('A' -10 +nib);
+    val    >>= 4;
+  }
+}
+
+#define TOK_SLOTS4(s)   tokInSlot(s, 0), tokInSlot(s+1, 0), \
+                        tokInSlot(s+2, 0), tokInSlot(s+3, 0)
+#define TOK_SLOTS16(s)  TOK_SLOTS4(s), TOK_SLOTS4(s+4), \
+                        TOK_SLOTS4(s+8), TOK_SLOTS4(s+12)
+
+const byte msgTokenSlots[TOK_HashSize] PROGMEM 
+                = {TOK_SLOTS16(0), TOK_SLOTS16(16), 
+                   TOK_SLOTS16(32), TOK_SLOTS16(48)};
+
+//--------------------------------------------------------------------------------
+static uint16_t updateCRC (uint16_t crc, byte b)
+// CRC-16/CCITT (polynomial 0x1021, not reflected); with MSG_BinCRCInit as 
+// start value, this gives the "CCITT-FALSE" variant
+{
+#if defined(__AVR__)
+  return _crc_xmodem_update(crc, b);
+#else
+  crc ^= (uint16_t)b << 8;
+  for (byte i = 0; i<8; i++)
+    crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+  return crc;
+#endif
+}
+
 //================================================================================
 // Class RMsg - Methods
 //--------------------------------------------------------------------------------
-RMsgClass::RMsgClass () 
+RMsgCore::RMsgCore (char* _inBuf, byte _inLen, char* _outBuf, byte _outLen,
+                    uint8_t* _txBuf, word _txLen)
+// The buffers are provided by the derived class (see RMsgT in RMsg.h), "_inLen",
+// "_outLen" and "_txLen" are their lengths without the terminating zero
 {
+  Buf           = _inBuf;
+  inLen         = _inLen;
+  msgOutBuf     = _outBuf;
+  outLen        = _outLen;
+  txBuf         = _txBuf;
+  txLen         = _txLen;
   msgOutBuf[0]  = '\0';
   iMsgOutBuf    = 0;
+  nBuf          = 0;
+  isInMsg       = false;
+  isBinary      = false;
+  isOutBinary   = false;
   isMsgStarted  = false;
+  isRemMsg      = false;
   isClient      = true;
   chStartClient = MSG_StartChr_Client;
   chStartHost   = MSG_StartChr_Host;
   cmdStream     = &Serial;
   debugStream   = NULL;
+  rxTag         = MSG_NoTag;
+  txTag         = MSG_NoTag;
+  iTxHead       = 0;
+  iTxTail       = 0;
+  nTx           = 0;
+  nTxDroppedSince = 0;
+  isStreaming   = false;
+  isHeaderDone  = false;
+  scnHandler    = NULL;
+  nHandlers     = 0;
+  for (byte i = 0; i<MSG_MaxHandlers; i++)
+    hdlFunc[i]  = NULL;
+  resetStats();
 }
 
 //--------------------------------------------------------------------------------
-void  RMsgClass::setStream (Stream *StreamCmd, Stream *StreamDebug)
+void  RMsgCore::setStream (Stream *StreamCmd, Stream *StreamDebug)
 // Set input/output stream and, if required, an extra output stream for debug
-// messages (currently only messages of the REM-type)
+// messages (currently only messages of the REM-type); messages still queued
+// for the previous stream are sent first
 {
+  flushTx();
   cmdStream = StreamCmd;
   if (StreamDebug != NULL)
     debugStream  = StreamDebug;
@@ -55,7 +240,7 @@ void  RMsgClass::setStream (Stream *StreamCmd, Stream *StreamDebug)
 }
 
 //--------------------------------------------------------------------------------
-void  RMsgClass::setIsHost(bool _isHost)
+void  RMsgCore::setIsHost(bool _isHost)
 // Set if client or host role
 {
   isClient  = !_isHost;
@@ -66,11 +251,39 @@ void  RMsgClass::setIsHost(bool _isHost)
 }
 
 //--------------------------------------------------------------------------------
-void  RMsgClass::beginMsg (token_t token)
+void  RMsgCore::setBinaryMode (bool _isBinary)
+// Switches the command stream between the ASCII (default) and the binary 
+// message format; a partially received message is discarded
+{
+  abortStream();
+  isBinary     = _isBinary;
+  isInMsg      = isBinary;
+  nBuf         = 0;
+  isMsgStarted = false;
+}
+
+bool  RMsgCore::getBinaryMode ()
+{
+  return isBinary;
+}
+
+//--------------------------------------------------------------------------------
+void  RMsgCore::beginMsg (token_t token)
 // Starts a message to the host; an already started message is discarded
 {
-  RString  MsgOutStr(msgOutBuf, MSG_MaxOutLen, 0);
+  startMsg(token, MSG_NoTag);
+}
+
+void  RMsgCore::beginReplyMsg (token_t token)
+// Starts a reply; it carries the tag set by "setTag" (or of the last received
+// message), which is then used up
+{
+  startMsg(token, txTag);
+  txTag = MSG_NoTag;
+}
 
+void  RMsgCore::startMsg (token_t token, int tag)
+{
   if(isMsgStarted) {
     // Discard previous message
     //
@@ -78,349 +291,1226 @@ void  RMsgClass::beginMsg (token_t token)
     isMsgStarted  = false;
   }
   if((token >= 0) && (token <= TOK_LastIndex)) {
-    sprintf_P(convStrBuf, PSTR("%c%s"), chStartClient, msgTokens[token]);
-    MsgOutStr     = convStrBuf;
-    iMsgOutBuf    = MsgOutStr.length();
+    isOutBinary   = isBinary;
+    if (isOutBinary) {
+      // First byte is reserved for the COBS encoding (see "finalizeMsg")
+      //
+      msgOutBuf[1]  = token;
+      iMsgOutBuf    = 2;
+      if (tag != MSG_NoTag) {
+        msgOutBuf[1] |= MSG_BinTagFlag;
+        msgOutBuf[iMsgOutBuf++] = tag;
+      }
+    }
+    else {
+      msgOutBuf[0]  = chStartClient;
+      memcpy_P(&msgOutBuf[1], msgTokens[token], TOK_StrLength);
+      iMsgOutBuf    = 1 +TOK_StrLength;
+      if (tag != MSG_NoTag) {
+        msgOutBuf[iMsgOutBuf++] = MSG_TagChr;
+        iMsgOutBuf += formatDec(&msgOutBuf[iMsgOutBuf], tag);
+      }
+      msgOutBuf[iMsgOutBuf] = 0;
+    }
     isMsgStarted  = true;  
+    isRemMsg      = false;
   }
 }
 
 //--------------------------------------------------------------------------------
-void  RMsgClass::appendDataToMsg (char sKey[], char  cFormat, int nData, int data[])
+void  RMsgCore::appendDataToMsg (char key, char  cFormat, int nData, 
+                                  const int data[])
+// Appends a data package with a single-character key to the current message
+{
+  appendDataToMsg(&key, 1, cFormat, nData, data);
+}
+
+void  RMsgCore::appendDataToMsg (char sKey[], char  cFormat, int nData, 
+                                  const int data[])
+{
+  appendDataToMsg(sKey, strlen(sKey), cFormat, nData, data);
+}
+
+void  RMsgCore::appendDataToMsg (const char* sKey, byte nKey, char  cFormat, 
+                                  int nData, const int data[])
 // Appends a data package to the current message
-//   sKey[]    := string, parameter key
+//   sKey, nKey:= parameter key and its length
 //   cFormat   := character, determines the representation format
 //                MSG_DecFormatChr  '=', 12,3456(,79...)
-//                MSG_WordFormatChr ':', FF(FF...)
-//                MSG_ByteFormatChr '.', FFFF(FFFF...)
+//                MSG_WordFormatChr ':', FFFF(FFFF...)
+//                MSG_ByteFormatChr '.', FF(FF...)
 //   nData     := number of data elements to append
 //   data      := data to append
+// In binary mode, the format is ignored and the data is always appended as
+// 16-bit words. In ASCII mode, the values are written directly to the output
+// buffer; values that do not fit are dropped (one character is kept free for 
+// the end-of-message character)
 {
-  RString  MsgOutStr(msgOutBuf, MSG_MaxOutLen, iMsgOutBuf);
+  char  *pOut, *pEnd;
 
-  if((isMsgStarted) && (strlen(sKey) > 0) &&
+  if((isMsgStarted) && (nKey > 0) &&
      ((cFormat == MSG_DecFormatChr) || (cFormat == MSG_WordFormatChr) || 
       (cFormat == MSG_ByteFormatChr))) 
   {
-    MsgOutStr += MSG_SpacerChr; 
-    MsgOutStr += sKey;
-    MsgOutStr += cFormat;
+    if (isOutBinary) {
+      appendBinDataToMsg(sKey[0], nData, data);
+      return;
+    }
+    pOut = &msgOutBuf[iMsgOutBuf];
+    pEnd = &msgOutBuf[outLen -1];
+    if ((pEnd -pOut) < (nKey +2))
+      return;
+    *pOut++ = MSG_SpacerChr[0];
+    memcpy(pOut, sKey, nKey);
+    pOut   += nKey;
+    *pOut++ = cFormat;
     switch (cFormat) {
       case MSG_DecFormatChr:
-        for(int i=0; i<nData; i+=1) {
-          itoa(data[i], convStrBuf, 10);
-          MsgOutStr += convStrBuf;
-          if(i < (nData-1)) { 
-            MsgOutStr += ',';
+        for(int i=0; (i < nData) && ((pEnd -pOut) >= MSG_MaxDecChars); i+=1) {
+          if(i > 0) { 
+            *pOut++ = ',';
           }  
+          pOut += formatDec(pOut, data[i]);
         } 
         break;
         
       case MSG_WordFormatChr:
-        for(int i=0; i<nData; i+=1) {
-          sprintf_P(convStrBuf, PSTR("%4X"), data[i]);
-          MsgOutStr += convStrBuf;
+        for(int i=0; (i < nData) && ((pEnd -pOut) >= 4); i+=1) {
+          formatHex(pOut, (word)data[i], 4);
+          pOut += 4;
         } 
         break;
         
       case MSG_ByteFormatChr:
-        for(int i=0; i<nData; i+=1) {
-          sprintf_P(convStrBuf, PSTR("%2X"), constrain(data[i], 0, 255));
-          MsgOutStr += convStrBuf;
+        for(int i=0; (i < nData) && ((pEnd -pOut) >= 2); i+=1) {
+          formatHex(pOut, constrain(data[i], 0, 255), 2);
+          pOut += 2;
         } 
         break;
     }
-    iMsgOutBuf = MsgOutStr.length();
+    *pOut      = 0;
+    iMsgOutBuf = pOut -msgOutBuf;
   }
 }
 
 //--------------------------------------------------------------------------------
-char* RMsgClass::finalizeMsg ()
-// Finalizes started message
+void  RMsgCore::appendBinDataToMsg (char key, int nData, const int data[])
+// Appends a data package in binary format: key, number of values and the 
+// values as 16-bit little-endian words; as many values as fit are appended
 {
-  RString  MsgOutStr(msgOutBuf, MSG_MaxOutLen, iMsgOutBuf);
+  int  nFree = outLen -MSG_BinTrailerLen -iMsgOutBuf -2;
+  byte *pOut;
 
-  if(isMsgStarted) {
-    MsgOutStr   += MSG_EndChr;
-    isMsgStarted = false;
-    return msgOutBuf;
+  if (nFree < 0)
+    return;
+  if (nData > (nFree /2))
+    nData = nFree /2;
+  pOut    = (byte*)&msgOutBuf[iMsgOutBuf];
+  *pOut++ = toupper(key);
+  *pOut++ = nData;
+  for(int i=0; i<nData; i+=1) {
+    *pOut++ = lowByte(data[i]);
+    *pOut++ = highByte(data[i]);
   }
-  else
+  iMsgOutBuf += 2 +2*nData;
+}
+
+//--------------------------------------------------------------------------------
+char* RMsgCore::finalizeMsg ()
+// Finalizes started message; in binary mode, the CRC is appended, the message
+// is COBS-encoded in place and terminated by MSG_BinDelimiter
+{
+  byte     *pBuf = (byte*)msgOutBuf;
+  uint16_t crc   = MSG_BinCRCInit;
+  int      iCode;
+  byte     code;
+
+  if(!isMsgStarted)
     return NULL;
+
+  isMsgStarted = false;
+  if(!isOutBinary) {
+    if(iMsgOutBuf < outLen)
+      msgOutBuf[iMsgOutBuf++] = MSG_EndChr;
+    msgOutBuf[iMsgOutBuf] = 0;
+    return msgOutBuf;
+  }
+  for(int i=1; i<iMsgOutBuf; i+=1)
+    crc = updateCRC(crc, pBuf[i]);
+  pBuf[iMsgOutBuf++] = lowByte(crc);
+  pBuf[iMsgOutBuf++] = highByte(crc);
+
+  // COBS: replace each zero by the distance to the next zero (or the end);
+  // because a message is shorter than 254 bytes, the distance always fits in 
+  // the byte and the payload does not need to be moved
+  //
+  iCode = 0;
+  code  = 1;
+  for(int i=1; i<iMsgOutBuf; i+=1) {
+    if(pBuf[i] == 0) {
+      pBuf[iCode] = code;
+      iCode       = i;
+      code        = 1;
+    }
+    else
+      code += 1;
+  }
+  pBuf[iCode] = code;
+  pBuf[iMsgOutBuf++] = MSG_BinDelimiter;
+  return msgOutBuf;
 }
 
 //--------------------------------------------------------------------------------
-char* RMsgClass::convertMsgToStr (Msg_t msg)
+char* RMsgCore::convertMsgToStr (const Msg_t* msg)
 // Converts a message structure into a string message
 {
   byte  j;
-  char  s[2] = " ";
 
-  beginMsg(msg.tok);
-  for(j=0; j<msg.nParams; j++) {
-    s[0] = char(msg.paramCh[j]);
-    appendDataToMsg(s, MSG_DecFormatChr, msg.nData[j], msg.data[j]);
-  }
+  beginMsg((*msg).tok);
+  for(j=0; j<(*msg).nParams; j++)
+    appendDataToMsg((*msg).paramCh[j], MSG_DecFormatChr, (*msg).nData[j], 
+                    (*msg).data[j]);
   finalizeMsg();
   return msgOutBuf;
 }
 
+char* RMsgCore::convertMsgToStr (const Msg_t& msg)
+{
+  return convertMsgToStr(&msg);
+}
+
 //--------------------------------------------------------------------------------
-void RMsgClass::clearMsg (Msg_t* msg)
+void RMsgCore::clearMsg (Msg_t* msg)
 // Clears a message srructure
 {
   memset(msg, 0, sizeof(Msg_t));
 }
 
 //--------------------------------------------------------------------------------
-char* RMsgClass::composeRemMsg (int strCode)
+char* RMsgCore::composeRemMsg (int strCode)
 // Compose a remark message
 {
   char     strBuf[STR_MaxLength];    
-  RString  MsgOutStr(msgOutBuf, MSG_MaxOutLen, 0);
 
-  MsgOutStr    = chStartClient;
-  MsgOutStr   += msgTokens[TOK_REM];
-  MsgOutStr   += MSG_SpacerChr;
   strcpy_P(strBuf, (char*)pgm_read_word(&(_Strs[strCode])));
-  MsgOutStr   += strBuf;
-  MsgOutStr   += MSG_EndChr;
-  isMsgStarted = false;
+  if (!beginRemMsg())
+    return NULL;
+  appendStrToRemMsg(strBuf);
+  return finalizeMsg();
+}
 
-  return msgOutBuf;
+//--------------------------------------------------------------------------------
+bool RMsgCore::beginRemMsg ()
+// Starts a remark message; it uses the binary format only if the binary mode
+// is active and remarks are sent via the command stream. While another 
+// message is composed, the remark is dropped (and counted as such), because
+// it would overwrite that message in the output buffer
+{
+  if (isMsgStarted && !isRemMsg) {
+    countUp(&stats.nTxDropped);
+    countUp(&nTxDroppedSince);
+    return false;
+  }
+  isOutBinary = isBinary && (debugStream == cmdStream);
+  if (isOutBinary) {
+    msgOutBuf[1]  = TOK_REM;
+    iMsgOutBuf    = 2;
+  }
+  else {
+    msgOutBuf[0]  = chStartClient;
+    memcpy_P(&msgOutBuf[1], msgTokens[TOK_REM], TOK_StrLength);
+    msgOutBuf[1 +TOK_StrLength] = MSG_SpacerChr[0];
+    iMsgOutBuf    = 2 +TOK_StrLength;
+    msgOutBuf[iMsgOutBuf] = 0;
+  }
+  isMsgStarted  = true;
+  isRemMsg      = true;
+  return true;
+}
+
+void RMsgCore::appendStrToRemMsg (char *s)
+{
+  RString  MsgOutStr(msgOutBuf, outLen, iMsgOutBuf);
+  int      n;
+
+  if (!isMsgStarted || !isRemMsg)
+    return;
+  if (isOutBinary) {
+    n = outLen -MSG_BinTrailerLen -iMsgOutBuf;
+    if (n > (int)strlen(s))
+      n = strlen(s);
+    if (n > 0) {
+      memcpy(&msgOutBuf[iMsgOutBuf], s, n);
+      iMsgOutBuf += n;
+    }
+  }
+  else {
+    MsgOutStr  += s;
+    iMsgOutBuf  = MsgOutStr.length();
+  }
+}
+
+void RMsgCore::sendRemMsg ()
+{
+  if (isRemMsg && (finalizeMsg() != NULL))
+    writeMsgOut(debugStream, true);
 }
 
 //--------------------------------------------------------------------------------
-void RMsgClass::beginRemMsg ()
+void RMsgCore::writeMsgOut (Stream *stream, bool canDrop)
+// Writes the finalized message to the stream; messages to the command stream
+// are queued. If the queue is full, a message that "canDrop" (REM) is dropped,
+// all others wait until enough queued bytes have been sent
 {
-  (*debugStream).print(chStartClient);
-  (*debugStream).print(msgTokens[TOK_REM]);
-  (*debugStream).print(MSG_SpacerChr);
+  int      n = isOutBinary ? iMsgOutBuf : iMsgOutBuf +2;
+  uint8_t  crlf[2] = {'\r', '\n'};
+
+  if ((txLen > 0) && (stream == cmdStream)) {
+    pumpTx(0);
+    if ((int)(txLen -nTx) < n) {
+      if (canDrop) {
+        countUp(&stats.nTxDropped);
+        countUp(&nTxDroppedSince);
+        return;
+      }
+      countUp(&stats.nTxStalls);
+      pumpTx(n);
+    }
+    stats.nTxBytes += n;
+    putTx((uint8_t*)msgOutBuf, iMsgOutBuf);
+    if (!isOutBinary)
+      putTx(crlf, 2);
+    pumpTx(0);
+    return;
+  }
+  if ((*stream).availableForWrite() < n)
+    countUp(&stats.nTxStalls);
+  stats.nTxBytes += n;
+  if (isOutBinary)
+    (*stream).write((uint8_t*)msgOutBuf, iMsgOutBuf);
+  else
+    (*stream).println(msgOutBuf);
+}
+
+//--------------------------------------------------------------------------------
+void  RMsgCore::putTx (const uint8_t* p, word n)
+// Appends "n" bytes to the transmit queue; the caller makes sure they fit
+{
+  word  k;
+
+  while (n > 0) {
+    k = txLen -iTxHead;
+    if (k > n)
+      k = n;
+    memcpy(&txBuf[iTxHead], p, k);
+    iTxHead += k;
+    if (iTxHead == txLen)
+      iTxHead = 0;
+    nTx += k;
+    p   += k;
+    n   -= k;
+  }
+}
+
+void  RMsgCore::pumpTx (word nFree)
+// Passes as many queued bytes to the command stream as it accepts without
+// waiting; if then fewer than "nFree" bytes are free in the queue, it waits 
+// until enough bytes have been sent
+{
+  int   nAvail = (*cmdStream).availableForWrite();
+  word  k;
+
+  while (nTx > 0) {
+    k = txLen -iTxTail;
+    if (k > nTx)
+      k = nTx;
+    if (nAvail > 0) {
+      if (k > (word)nAvail)
+        k = nAvail;
+      nAvail -= k;
+    }
+    else if ((txLen -nTx) >= nFree)
+      break;
+    else if (k > (nFree -(txLen -nTx)))
+      k = nFree -(txLen -nTx);
+    (*cmdStream).write(&txBuf[iTxTail], k);
+    iTxTail += k;
+    if (iTxTail == txLen)
+      iTxTail = 0;
+    nTx -= k;
+  }
 }
 
-void RMsgClass::appendStrToRemMsg (char *s)
+void  RMsgCore::updateTx ()
+// Passes queued bytes to the command stream without waiting; once the queue 
+// is empty, the REM messages dropped meanwhile are reported by one message
 {
-  (*debugStream).print(s);
+  char  s[MSG_MaxDecChars +10];
+  byte  n;
+
+  if (txLen == 0)
+    return;
+  pumpTx(0);
+  if ((nTx == 0) && (nTxDroppedSince > 0) && !isMsgStarted) {
+    n = formatDec(s, (nTxDroppedSince > 0x7FFF) ? 0x7FFF : nTxDroppedSince);
+    strcpy_P(&s[n], PSTR(" dropped"));
+    nTxDroppedSince = 0;
+    sendRemMsg(s);
+  }
 }
 
-void RMsgClass::sendRemMsg ()
+void  RMsgCore::flushTx ()
+// Waits until all queued bytes have been passed to the command stream
 {
-  (*debugStream).println(MSG_EndChr);
+  if (txLen > 0)
+    pumpTx(txLen);
 }
 
 //--------------------------------------------------------------------------------
-void RMsgClass::sendMsg()
+bool  RMsgCore::setHandler (token_t tok, MsgHandler_t handler)
+// Registers "handler" for the parameters of messages with token "tok" (NULL
+// removes it); returns false, if MSG_MaxHandlers tokens have a handler
 {
-  char* msgStr = finalizeMsg();
-  if (msgStr != NULL) {
-   (*cmdStream).println(msgStr);
+  byte  i, iFree = MSG_MaxHandlers;
+
+  for (i = 0; i<MSG_MaxHandlers; i++) {
+    if ((hdlFunc[i] != NULL) && (hdlTok[i] == tok)) {
+      hdlFunc[i] = handler;
+      if (handler == NULL)
+        nHandlers -= 1;
+      return true;
+    }
+    if ((hdlFunc[i] == NULL) && (iFree == MSG_MaxHandlers))
+      iFree = i;
   }
+  if (handler == NULL)
+    return true;
+  if (iFree == MSG_MaxHandlers)
+    return false;
+  hdlTok[iFree]  = tok;
+  hdlFunc[iFree] = handler;
+  nHandlers     += 1;
+  return true;
 }
 
-void RMsgClass::sendMsg(Msg_t msg)
+MsgHandler_t RMsgCore::findHandler (token_t tok)
 {
-  char* msgStr = convertMsgToStr(msg);
-  if (msgStr != NULL) {
-    (*cmdStream).println(msgStr);
+  if (nHandlers == 0)
+    return NULL;
+  for (byte i = 0; i<MSG_MaxHandlers; i++) {
+    if ((hdlFunc[i] != NULL) && (hdlTok[i] == tok))
+      return hdlFunc[i];
   }
+  return NULL;
+}
+
+//--------------------------------------------------------------------------------
+int   RMsgCore::getTag ()
+// Returns the tag of the last received message or MSG_NoTag
+{
+  return rxTag;
+}
+
+void  RMsgCore::setTag (int tag)
+// Sets the tag of the next reply (0..MSG_MaxTag, MSG_NoTag=none)
+{
+  txTag = ((tag >= 0) && (tag <= MSG_MaxTag)) ? tag : MSG_NoTag;
+}
+
+//--------------------------------------------------------------------------------
+const MsgStats_t* RMsgCore::getStats ()
+{
+  return &stats;
+}
+
+void  RMsgCore::resetStats ()
+{
+  memset(&stats, 0, sizeof(stats));
 }
 
 //--------------------------------------------------------------------------------
-void RMsgClass::sendConfirmMsg (token_t tok, int errCode, int errValue)
+void RMsgCore::sendMsg()
+{
+  if (finalizeMsg() != NULL)
+    writeMsgOut(cmdStream, false);
+}
+
+void RMsgCore::sendMsg(const Msg_t* msg)
+{
+  if (convertMsgToStr(msg) != NULL)
+    writeMsgOut(cmdStream, false);
+}
+
+void RMsgCore::sendMsg(const Msg_t& msg)
+{
+  sendMsg(&msg);
+}
+
+//--------------------------------------------------------------------------------
+void RMsgCore::sendConfirmMsg (token_t tok, int errCode, int errValue)
 // Depending on error code, it sends an error message or an acknowledgement 
 // to the host
 {
   int   data[2] = {byte(tok), 0};
-  char* msgStr;
 
   if (errCode == ERR_None) {
-    beginMsg(TOK_ACK);
-    appendDataToMsg("C", MSG_DecFormatChr, 1, data);
+    beginReplyMsg(TOK_ACK);
+    appendDataToMsg('C', MSG_DecFormatChr, 1, data);
   }
   else {
-    beginMsg(TOK_ERR);
-    appendDataToMsg("C", MSG_DecFormatChr, 1, data);
+    beginReplyMsg(TOK_ERR);
+    appendDataToMsg('C', MSG_DecFormatChr, 1, data);
     data[0] = errCode;
     data[1] = errValue;
-    appendDataToMsg("E", MSG_DecFormatChr, 2, data);
-  }
-  msgStr = finalizeMsg();
-  if (msgStr != NULL) {
-    (*cmdStream).println(msgStr);
+    appendDataToMsg('E', MSG_DecFormatChr, 2, data);
   }
+  sendMsg();
 }
 
 //--------------------------------------------------------------------------------
-void RMsgClass::sendRemMsg (int strCode)
+void RMsgCore::sendRemMsg (int strCode)
 {
-  (*debugStream).println(composeRemMsg(strCode));
+  if (composeRemMsg(strCode) != NULL)
+    writeMsgOut(debugStream, true);
 }
 
-void RMsgClass::sendRemMsg(char *s)
+void RMsgCore::sendRemMsg(char *s)
 {
-  (*debugStream).print(chStartClient);
-  (*debugStream).print("REM ");
-  (*debugStream).print(s);
-  (*debugStream).println(MSG_EndChr);
+  beginRemMsg();
+  appendStrToRemMsg(s);
+  sendRemMsg();
 }
 
 //--------------------------------------------------------------------------------
-void RMsgClass::sendVerMsg (int ver, int freeRAM)
+void RMsgCore::sendVerMsg (int ver, int freeRAM)
 {
   int data[1];
 
-  beginMsg(TOK_VER);
+  beginReplyMsg(TOK_VER);
   data[0] = ver;
-  appendDataToMsg("V", MSG_DecFormatChr, 1, data);
+  appendDataToMsg('V', MSG_DecFormatChr, 1, data);
   data[0] = freeRAM;
-  appendDataToMsg("M", MSG_DecFormatChr, 1, data);
+  appendDataToMsg('M', MSG_DecFormatChr, 1, data);
   sendMsg();
 }
 
 //--------------------------------------------------------------------------------
-token_t RMsgClass::readMsgFromStream (Msg_t* msg)
+token_t RMsgCore::readMsgFromStream (Msg_t* msg)
 // Check of data is available on the stream connected to the host and parse
 // the data. Returns a command token, if a complete message was recognized, and
 // the message data, including command and parameter fields, in "msg". Returns 
 // immediately of no data is available.
 //
+// The routine never waits for data: it consumes only the bytes that are already
+// available and keeps a partially received message in "Buf" until one of the 
+// next calls completes it. At most one message is returned per call.
+//
 // Except for checking the validity of the token and the message format, this
 // routine does not check if the parameter fields match the command. This needs
 // to be taken care of by the caller.
 // For message structure see class RMsg
 //
+{
+  updateTx();
+  txTag = MSG_NoTag;
+  if ((msg == NULL) || !receiveMsg())
+    return TOK_NONE;
+  return parseMsg(msg, NULL);
+}
+
+//--------------------------------------------------------------------------------
+token_t RMsgCore::readMsgViewFromStream (MsgView_t* view)
+// Like "readMsgFromStream" but the parameter values are not copied; "view" 
+// only refers to them in "Buf" and is valid until the next read call
+{
+  updateTx();
+  txTag = MSG_NoTag;
+  if ((view == NULL) || !receiveMsg())
+    return TOK_NONE;
+  return parseMsg(NULL, view);
+}
+
+//--------------------------------------------------------------------------------
+bool  RMsgCore::receiveMsg ()
+// Consumes the bytes available from the host; returns true, if a message is
+// complete in "Buf"
 {
   char    ch;
-  char    *pTok, *pCh, *pBuf, *pErrCh;
-//char    Buf[MSG_MaxInLen];
-//int     nBuf;
-  byte    i;
-  int     j;
-  int     convRes;
+  int     nAvail;
   boolean isMsgComplete = false;
 
-  if ((msg == NULL) || (!(*cmdStream).available()))
+  // Read the bytes that are already available from host and process ...
+  //
+  nAvail = (*cmdStream).available();
+  while ((nAvail > 0) && !isMsgComplete) {
+    ch      = (*cmdStream).read();
+    nAvail -= 1;
+
+    if (isBinary) {
+      if (ch == MSG_BinDelimiter) {
+        // End of binary message, which is also the start of the next one
+        //
+        isMsgComplete = isInMsg && (nBuf > 0);
+        isInMsg       = true;
+        if (!isMsgComplete)
+          nBuf        = 0;
+      }
+      else if (isInMsg) {
+        if (nBuf < inLen)
+          Buf[nBuf++] = ch;
+        else {
+          // Message too long, discard up to the next delimiter
+          //
+          isInMsg     = false;
+          countUp(&stats.nRxErrs[MSG_RxErr_TooLong]);
+        }
+      }
+    }
+    else if (ch == chStartHost) {
+      // Start of message found; an unfinished message is discarded
+      //
+      abortStream();
+      nBuf    = 0;
+      isInMsg = true;
+      isHeaderDone = (nHandlers == 0);
+    }
+    else if (isInMsg) {
+      if (isStreaming) {
+        // Parameters are passed on to the handler as they arrive ...
+        //
+        if (ch == MSG_EndChr) {
+          isInMsg       = false;
+          isMsgComplete = true;
+        }
+        else if (!scanChar(ch)) {
+          isInMsg       = false;
+          isStreaming   = false;
+          failHandler(ERR_InvalidOrTooFewParams, scnPos);
+        }
+      }
+      else if (ch == MSG_EndChr) {
+        // Message end character detected ...
+        //
+        isInMsg       = false;
+        isMsgComplete = (nBuf >= MSG_MinInLen);
+      }
+      else if (nBuf < (inLen -1)) {
+        Buf[nBuf++] = ch;
+        if (!isHeaderDone && ((byte)ch <= ' ')) {
+          // End of token (and tag): stream the parameters, if the token
+          // has a handler
+          //
+          isHeaderDone = true;
+          isInMsg      = beginStream();
+        }
+      }
+      else {
+        // Message too long, discard
+        //
+        isInMsg = false;
+        countUp(&stats.nRxErrs[MSG_RxErr_TooLong]);
+      }
+    }
+  }
+  return isMsgComplete;
+}
+
+//--------------------------------------------------------------------------------
+token_t RMsgCore::parseMsg (Msg_t* msg, MsgView_t* view)
+// Parses the complete message in "Buf" into either "msg" or "view"
+{
+  token_t tok;
+  int     i;
+  boolean isOk;
+
+  if (isStreaming)
+    return endStream(msg, view);
+  rxTag = MSG_NoTag;
+  if (isBinary)
+    return decodeBinMsg(msg, view);
+
+  // Read the optional tag that follows the token (e.g. ">SDV#17 ...") first,
+  // so that also an error reply carries it ...
+  //
+  Buf[nBuf] = 0;
+  i = parseTag();
+  if (i < 0)
     return TOK_NONE;
 
-  // Initialize message
+  // Identify token ...
+  //
+  tok = findToken(Buf);
+  if (tok == TOK_NONE) {
+    // Token could not be identified, discard message ...
+    //
+    countUp(&stats.nRxErrs[MSG_RxErr_Token]);
+    sendConfirmMsg(TOK_NONE, ERR_CmdNotRecognized, 0);
+    return TOK_NONE;
+  }
+  // ... and parse message parameters in a single pass (or pass them on to the
+  // handler of the token)
   //
+  beginScan(msg, view, i);
+  if (!beginHandler(tok, i))
+    return TOK_NONE;
+  isOk = true;
+  for (; (i < nBuf) && isOk; i++)
+    isOk = scanChar(Buf[i]);
+  if (!isOk || !endScan()) {
+    if (scnHandler != NULL)
+      failHandler(ERR_InvalidOrTooFewParams, scnPos);
+    else {  
+      countUp(&stats.nRxErrs[MSG_RxErr_Params]);
+      sendConfirmMsg(tok, ERR_InvalidOrTooFewParams, scnPos);
+    }  
+    return TOK_NONE;
+  }
+  if (scnHandler != NULL)
+    (*scnHandler)(MSG_Hdl_End, 0, ERR_None);
+  countUp(&stats.nRx);
+  if (view != NULL)
+    (*view).tok = tok;
+  else  
+    (*msg).tok  = tok;
+  return tok;
+}
+
+int   RMsgCore::parseTag ()
+// Reads the optional tag that follows the token in "Buf"; returns the position
+// after the token and tag or -1, if the tag is invalid (an error reply is sent)
+{
+  int  i = TOK_StrLength;
+
+  if (Buf[i] == MSG_TagChr) {
+    rxTag = 0;
+    while ((++i < nBuf) && (Buf[i] >= '0') && (Buf[i] <= '9') && 
+           (rxTag <= MSG_MaxTag))
+      rxTag = rxTag *10 +(Buf[i] -'0');
+    if ((i == TOK_StrLength +1) || (rxTag > MSG_MaxTag)) {
+      rxTag = MSG_NoTag;
+      countUp(&stats.nRxErrs[MSG_RxErr_Params]);
+      sendConfirmMsg(findToken(Buf), ERR_InvalidOrTooFewParams, i);
+      return -1;
+    }
+    txTag = rxTag;
+  }
+  return i;
+}
+
+//--------------------------------------------------------------------------------
+bool  RMsgCore::beginHandler (token_t tok, word pos)
+// If token "tok" has a handler, the scanner (see "beginScan") passes the
+// parameters to it instead; returns false, if the handler rejects the message
+// (an error reply is sent)
+{
+  scnHandler = findHandler(tok);
+  scnTok     = tok;
+  if (scnHandler == NULL)
+    return true;
+  scnMsg     = NULL;
+  scnView    = NULL;
+  if (!(*scnHandler)(MSG_Hdl_Begin, 0, tok)) {
+    failHandler(ERR_InvalidOrTooFewParams, pos);
+    return false;
+  }
+  return true;
+}
+
+bool  RMsgCore::beginStream ()
+// Called at the end of the token (and tag) of an ASCII message in "Buf"; if 
+// the token has a handler, the rest of the message is passed on to it while
+// it is received. Returns false, if the message is to be discarded
+{
+  token_t tok;
+  int     i;
+
+  if ((nBuf <= TOK_StrLength) || 
+      (findHandler(tok = findToken(Buf)) == NULL))
+    return true;
+  rxTag = MSG_NoTag;
+  Buf[nBuf] = 0;
+  if ((i = parseTag()) < 0)
+    return false;
+  beginScan(NULL, NULL, i);
+  if (!beginHandler(tok, i))
+    return false;
+  isStreaming = true;
+  for (; i < nBuf; i++) {
+    if (!scanChar(Buf[i])) {
+      isStreaming = false;
+      failHandler(ERR_InvalidOrTooFewParams, scnPos);
+      return false;
+    }
+  }
+  return true;
+}
+
+token_t RMsgCore::endStream (Msg_t* msg, MsgView_t* view)
+// Completes a message whose parameters were passed on while it was received
+{
+  isStreaming = false;
+  txTag       = rxTag;
+  if (!endScan()) {
+    failHandler(ERR_InvalidOrTooFewParams, scnPos);
+    return TOK_NONE;
+  }
+  (*scnHandler)(MSG_Hdl_End, 0, ERR_None);
+  countUp(&stats.nRx);
+  if (view != NULL) {
+    (*view).tok     = scnTok;
+    (*view).nParams = 0;
+  }
+  if (msg != NULL) {
+    (*msg).tok      = scnTok;
+    (*msg).nParams  = 0;
+  }
+  return scnTok;
+}
+
+void  RMsgCore::abortStream ()
+// Discards a message that is being passed on to the handler, e.g. when the
+// next message starts before it is complete
+{
+  if (!isStreaming)
+    return;
+  isStreaming = false;
+  countUp(&stats.nRxErrs[MSG_RxErr_Params]);
+  (*scnHandler)(MSG_Hdl_End, 0, ERR_InvalidOrTooFewParams);
+}
+
+void  RMsgCore::failHandler (int errCode, int errValue)
+// Rejects a message that is passed on to a handler: sends the error reply
+// and ends the message for the handler
+{
+  countUp(&stats.nRxErrs[MSG_RxErr_Params]);
+  txTag = rxTag;
+  sendConfirmMsg(scnTok, errCode, errValue);
+  (*scnHandler)(MSG_Hdl_End, 0, errCode);
+}
+
+//--------------------------------------------------------------------------------
+void  RMsgCore::beginScan (Msg_t* msg, MsgView_t* view, word pos)
+// Prepares the parameter scanner for a new message; the scanner starts with 
+// the character at "pos" that follows the token (and tag) and fills either 
+// "msg" or "view" (or neither, see "beginHandler")
+{
+  scnMsg   = msg;
+  scnView  = view;
+  scnState = SCN_TokenEnd;
+  scnPos   = pos;
+  scnHandler = NULL;
+  if (view != NULL) {
+    (*view).tok     = TOK_NONE;
+    (*view).nParams = 0;
+    return;
+  }
+  if (msg == NULL)
+    return;
   (*msg).tok = TOK_NONE;
   (*msg).nParams = 0;
-  for (i = 0; i<TOK_MaxParams; i++)
+  for (byte i = 0; i<TOK_MaxParams; i++)
     (*msg).nData[i] = 0;
+}
 
-  // Read bytes, if any, from host and process ...
-  //
-  while ((*cmdStream).available()) {
-    ch = (*cmdStream).read();
+//--------------------------------------------------------------------------------
+bool  RMsgCore::scanChar (char ch)
+// Scans the next character of the parameter list; parameter keys are turned 
+// into upper case and the values are converted on the fly. Returns false, if
+// the character is invalid at this position (see "scnPos")
+{
+  MsgParamView_t *pView;
+  byte  nib;
 
-    if (ch == chStartHost) {
-      // Start of message found, read more data until message end character 
-      // is detected or a time-out occurs ...
+  switch (scnState) {
+    case SCN_TokenEnd:
+      // Token needs to be followed by a space
       //
-      nBuf = 0;
-      nBuf = (*cmdStream).readBytesUntil(MSG_EndChr, Buf, MSG_MaxInLen);
-      isMsgComplete = (nBuf >= MSG_MinInLen) && (nBuf < MSG_MaxInLen);
-      if (isMsgComplete) {
-        // Success
-        // 
-        Buf[nBuf++] = 0;
+      if ((byte)ch > ' ')
+        return false;
+      scnState = SCN_Space;
+      break;
+
+    case SCN_Space:
+      // Skip spaces, the next parameter starts with its key
+      //
+      if ((byte)ch <= ' ')
+        break;
+      if ((tokUpper(ch) < 'A') || (tokUpper(ch) > 'Z') || 
+          !addScannedParam(tokUpper(ch)))
+        return false;
+      scnState = SCN_Format;
+      break;
+
+    case SCN_Format:
+      if (scnView != NULL) {
+        pView = &(*scnView).param[(*scnView).nParams -1];
+        (*pView).fmt  = ch;
+        (*pView).offs = scnPos +1;
       }
+      if (ch == MSG_DecFormatChr)
+        scnState = SCN_DecStart;
+      else if ((ch == MSG_WordFormatChr) || (ch == MSG_ByteFormatChr)) {
+        scnHexLen  = (ch == MSG_WordFormatChr) ? 4 : 2;
+        scnNDigits = 0;
+        scnVal     = 0;
+        scnIsNeg   = false;
+        scnState   = SCN_HexStart;
+      }
+      else
+        return false;
       break;
-    }
-  }
-  if (isMsgComplete) {
-    // Identify token ...
-    //
-    (*msg).tok = TOK_NONE;
-    ch = Buf[TOK_StrLength];
-    Buf[TOK_StrLength] = 0;
-    for (j = 0; j <= TOK_LastIndex; j++) {
-      if (strcasecmp(msgTokens[j], Buf) == 0) {
-        (*msg).tok = j;
+
+    case SCN_HexDigits:
+      // A space after the last digit of a value ends the parameter
+      //
+      if ((scnNDigits == 0) && ((byte)ch <= ' ')) {
+        scnState = SCN_Space;
         break;
       }
-    }
-    Buf[TOK_StrLength] = ch;
-    if ((*msg).tok == TOK_NONE) {
-      // Token could not be identified, discard message ...
+      // fall through
+    case SCN_HexStart:
+      // Values of fixed length (4 or 2 hex digits) without separators ...
       //
-      sendConfirmMsg(TOK_NONE, ERR_CmdNotRecognized, 0);
-    }
-    else {
-      // Check if the message contains parameter
+      nib = hexNibble(ch);
+      if (nib == HEX_Invalid)
+        return false;
+      scnVal = (scnVal << 4) | nib;
+      if (++scnNDigits == scnHexLen) {
+        if (!addScannedValue())
+          return false;
+        scnNDigits = 0;
+        scnVal     = 0;
+      }
+      scnState = SCN_HexDigits;
+      break;
+
+    case SCN_DecStart:
+      // Start of a decimal value, optionally with a sign ...
       //
-      strupr(Buf);
-      if (nBuf >= (TOK_StrLength + TOK_MinParamStrLength + 1)) {
-        // Parse message parameters ...
-        //
-        pBuf = &Buf[TOK_StrLength + 1];
-        pTok = strtok_r(pBuf, MSG_SpacerChr, &pCh);
-
-        while (pTok != NULL) {
-          if (strlen(pTok) >= TOK_MinParamStrLength) {
-            // String of sufficient length for parameter found
-            //
-            (*msg).paramCh[(*msg).nParams] = pTok[0];
-            switch (pTok[1]) {
-            case MSG_DecFormatChr:
-              // Parse comma separated decimal parameters ...
-              //
-              pTok += 2;
-              convRes = 0;
-              do {
-                i = (*msg).nData[(*msg).nParams];
-                (*msg).data[(*msg).nParams][i] = strtol(pTok, &pErrCh, 10);
-                if (pErrCh == pTok) {
-                  // Nothing to convert, abort ...
-                  // 
-                  convRes = -1;
-                }
-                else {
-                  // Conversion was successful
-                  //
-                  (*msg).nData[(*msg).nParams]++;
-                  if ((*msg).nData[(*msg).nParams] == TOK_MaxData)
-                    break;
-
-                  // Check whether more data entries are in the list or not
-                  //
-                  if (*pErrCh == 0)
-                    convRes = 1;
-                  else {
-                    pTok = pErrCh + 1;
-                  }
-                }
-              } while (convRes == 0);
-              break;
-
-            case MSG_WordFormatChr:
-            case MSG_ByteFormatChr:
-              //***************
-              //**** TODO *****
-              //***************
-              break;
-            }
-            (*msg).nParams++;
-          }
-          if ((*msg).nParams == TOK_MaxParams)
-            pTok = NULL;
-          else
-            pTok = strtok_r(NULL, MSG_SpacerChr, &pCh);
-        }
+      scnVal   = 0;
+      scnIsNeg = (ch == '-');
+      if ((ch == '-') || (ch == '+')) {
+        scnState = SCN_DecSign;
+        break;
       }
+      // fall through
+    case SCN_DecSign:
+      if ((ch < '0') || (ch > '9'))
+        return false;
+      scnVal   = ch -'0';
+      scnState = SCN_DecDigits;
+      break;
+
+    case SCN_DecDigits:
+      if ((ch >= '0') && (ch <= '9')) {
+        scnVal = scnVal *10 +(ch -'0');
+        break;
+      }
+      // End of value, followed by the next value of the list or the next
+      // parameter
+      //
+      if (!addScannedValue())
+        return false;
+      if (ch == MSG_SepChr[0]) 
+        scnState = SCN_DecStart;
+      else if ((byte)ch <= ' ')
+        scnState = SCN_Space;
+      else
+        return false;
+      break;
+  }
+  scnPos += 1;
+  return true;
+}
+
+//--------------------------------------------------------------------------------
+bool  RMsgCore::endScan ()
+// Completes the scan at the end of the message; returns false, if the last
+// parameter is incomplete
+{
+  switch (scnState) {
+    case SCN_TokenEnd:
+    case SCN_Space:
+      return true;
+
+    case SCN_DecDigits:
+      return addScannedValue();
+
+    case SCN_HexDigits:
+      return (scnNDigits == 0);
+  }
+  return false;
+}
+
+//--------------------------------------------------------------------------------
+bool  RMsgCore::addScannedParam (char key)
+// Starts a new parameter; returns false, if there are already TOK_MaxParams
+// (or the handler rejects it)
+{
+  if (scnHandler != NULL) {
+    scnKey = key;
+    return (*scnHandler)(MSG_Hdl_Param, key, 0);
+  }
+  if (scnView != NULL) {
+    if ((*scnView).nParams >= TOK_MaxParams)
+      return false;
+    (*scnView).param[(*scnView).nParams].key   = key;
+    (*scnView).param[(*scnView).nParams].nData = 0;
+    (*scnView).nParams++;
+    return true;
+  }
+  if ((*scnMsg).nParams >= TOK_MaxParams)
+    return false;
+  (*scnMsg).paramCh[(*scnMsg).nParams++] = key;
+  return true;
+}
+
+bool  RMsgCore::addScannedValue ()
+// Adds the value just scanned to the current parameter (16-bit, wraps around
+// like the former conversion via strtol); returns false, if the parameter 
+// has already TOK_MaxData values (a view only counts the values)
+{
+  byte  iPar;
+
+  if (scnHandler != NULL)
+    return (*scnHandler)(MSG_Hdl_Value, scnKey, 
+                         (int16_t)(scnIsNeg ? -scnVal : scnVal));
+  if (scnView != NULL) {
+    iPar = (*scnView).nParams -1;
+    if ((*scnView).param[iPar].nData == 0xFF)
+      return false;
+    (*scnView).param[iPar].nData++;
+    return true;
+  }
+  iPar = (*scnMsg).nParams -1;
+  if ((*scnMsg).nData[iPar] >= TOK_MaxData)
+    return false;
+  (*scnMsg).data[iPar][(*scnMsg).nData[iPar]++] = 
+    (int16_t)(scnIsNeg ? -scnVal : scnVal);
+  return true;
+}
+
+//--------------------------------------------------------------------------------
+token_t RMsgCore::findToken (const char* s)
+// Returns the index of the token that matches the first three characters of
+// "s" (case-insensitive) or TOK_NONE
+{
+  token_t tok = pgm_read_byte(&msgTokenSlots[tokHash(s[0], s[1], s[2])]);
+
+  if ((tok == TOK_NONE) ||
+      (tokUpper(s[0]) != pgm_read_byte(&msgTokens[tok][0])) ||
+      (tokUpper(s[1]) != pgm_read_byte(&msgTokens[tok][1])) ||
+      (tokUpper(s[2]) != pgm_read_byte(&msgTokens[tok][2])))
+    return TOK_NONE;
+  return tok;
+}
+
+//--------------------------------------------------------------------------------
+token_t RMsgCore::decodeBinMsg (Msg_t* msg, MsgView_t* view)
+// Decodes the binary message in "Buf" (for the format see "finalizeMsg") into
+// either "msg" or "view"; replies with an error message if the message is 
+// corrupted
+{
+  byte    *pBuf = (byte*)Buf;
+  int     n, iIn, iOut, k;
+  byte    code, iPar, nData;
+  token_t tok;
+  int     errCode = ERR_None;
+  uint16_t crc  = MSG_BinCRCInit;
+  MsgParamView_t *pView;
+
+  n    = nBuf;
+  nBuf = 0;
+  if (view != NULL) {
+    (*view).tok     = TOK_NONE;
+    (*view).nParams = 0;
+  }
+  else {
+    (*msg).tok = TOK_NONE;
+    (*msg).nParams = 0;
+    for (k = 0; k<TOK_MaxParams; k++)
+      (*msg).nData[k] = 0;
+  }
+
+  // Undo the COBS encoding in place ...
+  //
+  iIn  = 0;
+  iOut = 0;
+  while ((iIn < n) && (iOut >= 0)) {
+    code = pBuf[iIn++];
+    if ((iIn +code -1) > n) 
+      iOut = -1;
+    else {  
+      for (k = 1; k<code; k++)
+        pBuf[iOut++] = pBuf[iIn++];
+      if ((code < 0xFF) && (iIn < n))
+        pBuf[iOut++] = 0;
+    }
+  }
+  // ... and check the CRC
+  //
+  if (iOut >= 3) {
+    for (k = 0; k<(iOut -2); k++)
+      crc = updateCRC(crc, pBuf[k]);
+  }
+  if ((iOut < 3) || 
+      (pBuf[iOut -2] != lowByte(crc)) || (pBuf[iOut -1] != highByte(crc))) {
+    countUp(&stats.nRxErrs[MSG_RxErr_Checksum]);
+    sendConfirmMsg(TOK_NONE, ERR_ChecksumError, 0);
+    return TOK_NONE;
+  }
+  // Token, with the tag flag set followed by the tag ...
+  //
+  n   = iOut -2;
+  iIn = 1;
+  tok = pBuf[0] & ~MSG_BinTagFlag;
+  if ((pBuf[0] & MSG_BinTagFlag) && (n > 1)) {
+    rxTag = pBuf[iIn++];
+    txTag = rxTag;
+  }
+  if (tok > TOK_LastIndex) {
+    countUp(&stats.nRxErrs[MSG_RxErr_Token]);
+    sendConfirmMsg(TOK_NONE, ERR_CmdNotRecognized, 0);
+    return TOK_NONE;
+  }
+  // Parse message parameters (REM messages contain only text), or pass them
+  // on to the handler of the token ...
+  //
+  scnHandler = findHandler(tok);
+  scnTok     = tok;
+  if ((scnHandler != NULL) && !(*scnHandler)(MSG_Hdl_Begin, 0, tok)) {
+    failHandler(ERR_InvalidOrTooFewParams, iIn);
+    return TOK_NONE;
+  }
+  while ((scnHandler != NULL) && (iIn < n)) {
+    nData = ((iIn +2) <= n) ? pBuf[iIn +1] : 0xFF;
+    if (((iIn +2 +2*nData) > n) || 
+        !(*scnHandler)(MSG_Hdl_Param, toupper(pBuf[iIn]), 0)) {
+      errCode = ERR_InvalidOrTooFewParams;
+      break;
+    }
+    for (k = 0; (k<nData) && (errCode == ERR_None); k++) {
+      if (!(*scnHandler)(MSG_Hdl_Value, toupper(pBuf[iIn]), 
+                         (int16_t)(pBuf[iIn +2 +2*k] | (pBuf[iIn +3 +2*k] << 8))))
+        errCode = ERR_InvalidOrTooFewParams;
+    }
+    if (errCode != ERR_None)
+      break;
+    iIn += 2 +2*nData;
+  }
+  while ((scnHandler == NULL) && (tok != TOK_REM) && (iIn < n)) {
+    iPar = (view != NULL) ? (*view).nParams : (*msg).nParams;
+    if ((iPar == TOK_MaxParams) || ((iIn +2) > n)) {
+      errCode = ERR_InvalidOrTooFewParams;
+      break;
+    }
+    nData = pBuf[iIn +1];
+    if (((view == NULL) && (nData > TOK_MaxData)) || ((iIn +2 +2*nData) > n)) {
+      errCode = ERR_InvalidOrTooFewParams;
+      break;
+    }
+    if (view != NULL) {
+      pView = &(*view).param[iPar];
+      (*pView).key   = toupper(pBuf[iIn]);
+      (*pView).fmt   = MSG_BinFormatChr;
+      (*pView).nData = nData;
+      (*pView).offs  = iIn +2;
+      iIn += 2 +2*nData;
+      (*view).nParams++;
+      continue;
     }
+    (*msg).paramCh[iPar] = toupper(pBuf[iIn]);
+    (*msg).nData[iPar]   = nData;
+    iIn += 2;
+    for (k = 0; k<nData; k++) {
+      (*msg).data[iPar][k] = (int16_t)(pBuf[iIn] | (pBuf[iIn +1] << 8));
+      iIn += 2;
+    }
+    (*msg).nParams++;
+  }
+  if (errCode != ERR_None) {
+    if (scnHandler != NULL)
+      failHandler(errCode, iIn);
+    else {  
+      countUp(&stats.nRxErrs[MSG_RxErr_Params]);
+      sendConfirmMsg(tok, errCode, iIn);
+    }  
+    return TOK_NONE;
   }
+  if (scnHandler != NULL)
+    (*scnHandler)(MSG_Hdl_End, 0, ERR_None);
+  countUp(&stats.nRx);
+  if (view != NULL)
+    return ((*view).tok = tok);
+  (*msg).tok = tok;
   return (*msg).tok;
 }
 
-char* RMsgClass::getPtrToInBuf()
+//--------------------------------------------------------------------------------
+void  RMsgCore::beginViewData (const MsgView_t* view, byte iParam, 
+                                MsgDataIter_t* it)
+// Prepares iterating over the values of parameter "iParam" of "view"
+{
+  (*it).nLeft = 0;
+  if (iParam >= (*view).nParams)
+    return;
+  (*it).p     = &Buf[(*view).param[iParam].offs];
+  (*it).fmt   = (*view).param[iParam].fmt;
+  (*it).nLeft = (*view).param[iParam].nData;
+}
+
+bool  RMsgCore::nextViewData (MsgDataIter_t* it, int* val)
+// Converts the next value of the parameter; returns false, if there are no 
+// more values. The values have already been validated by the scanner
+{
+  const byte *p = (const byte*)(*it).p;
+  bool  isNeg;
+  word  v = 0;
+
+  if ((*it).nLeft == 0)
+    return false;
+  (*it).nLeft -= 1;
+
+  switch ((*it).fmt) {
+    case MSG_BinFormatChr:
+      v  = p[0] | (p[1] << 8);
+      p += 2;
+      break;
+
+    case MSG_WordFormatChr:
+      v  = hexNibble(*p++);
+      v  = (v << 4) | hexNibble(*p++);
+      // fall through
+    case MSG_ByteFormatChr:
+      v  = (v << 4) | hexNibble(*p++);
+      v  = (v << 4) | hexNibble(*p++);
+      break;
+
+    default:
+      isNeg = (*p == '-');
+      if ((*p == '-') || (*p == '+'))
+        p++;
+      while ((*p >= '0') && (*p <= '9'))
+        v = v *10 +(*p++ -'0');
+      if (*p == MSG_SepChr[0])
+        p++;
+      if (isNeg)
+        v = -v;
+      break;
+  }
+  (*it).p = (const char*)p;
+  *val    = (int16_t)v;
+  return true;
+}
+
+//--------------------------------------------------------------------------------
+char* RMsgCore::getPtrToInBuf()
 {
   return Buf;
 }
 
 //--------------------------------------------------------------------------------
-bool  RMsgClass::checkMsg (Msg_t* msg, bool asCmd)
+bool  RMsgCore::checkMsg (Msg_t* msg, bool asCmd)
 // Checks if the parameters are complete and fit to the message token; two cases
 // are distinguished: 1) token as command and 2) token as reply, if required
 {
@@ -430,10 +1520,21 @@ bool  RMsgClass::checkMsg (Msg_t* msg, bool asCmd)
   switch ((*msg).tok) {
     case TOK_REM:
     case TOK_NONE:
-    case TOK_STA:
       res = ((*msg).nParams == 0);
       break;
 
+    case TOK_STA:
+      // Optional reset of the counters (R=1); the reply is application-
+      // specific
+      //
+      if (asCmd)
+        res = (((*msg).nParams == 0) || 
+               (((*msg).nParams == 1) && ((*msg).paramCh[0] == 'R') &&
+                ((*msg).nData[0] == 1)));
+      else
+        res = true;
+      break;
+
     case TOK_DUM:
       res = true;
       break;
@@ -457,6 +1558,11 @@ bool  RMsgClass::checkMsg (Msg_t* msg, bool asCmd)
       res = (((*msg).nParams == 1) &&
             ((*msg).paramCh[0] == 'C') && ((*msg).nData[0] == 1));
       break;
+
+    case TOK_BIN:
+      res = (((*msg).nParams == 1) &&
+            ((*msg).paramCh[0] == 'M') && ((*msg).nData[0] == 1));
+      break;
   }
   return res;
 }  
@@ -465,7 +1571,7 @@ bool  RMsgClass::checkMsg (Msg_t* msg, bool asCmd)
 // Preinstantiate Object
 // 
 #ifndef RMsg_NoPreinstantiatedObject
-RMsgClass RMsg = RMsgClass();
+RMsgClass RMsg;
 #endif
 
 //--------------------------------------------------------------------------------
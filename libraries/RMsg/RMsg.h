@@ -32,10 +32,36 @@
             v0.6 2015-08-28, small changes for "RMsg_generalIOExtension"
             v0.7 2016-01-07, expanded message size to 4x18 int parameters
                  2017-08-13, moved message size definition to RMsg_DEFINITIONs.h
+            v0.8 2026-10-17, non-blocking, incremental reading of messages
+                             optional binary message format
+                             token lookup via perfect hash
+                             single-pass parameter scanner
+                             parsing of word (':') and byte ('.') formats
+                             direct number formatting in appendDataToMsg
+                             messages passed by reference, parameter views
+                             message statistics (getStats, resetStats)
+                             transmit queue (updateTx, flushTx)
+                             optional message tags (getTag, setTag)
+                             buffer lengths per object (RMsgT template)
+                             parameter handlers for long messages 
+                             (setHandler)
+                             token strings in flash, single-character keys
+                             tags only used by replies (beginReplyMsg)
 
 
   Class "RMsgClass" (only object "RMsg")
   --------------------------------------
+  "RMsgClass" is "RMsgT" with the buffer lengths from RMsg_DEFINITIONS.h:
+    template <int InLen, int OutLen, int TxLen> class RMsgT
+  An object has an input buffer of "InLen" and an output buffer of "OutLen"
+  characters and a transmit queue of "TxLen" bytes (0=send directly), e.g.
+    RMsgT<32, 48, 0>  RMsgDebug;
+  for a second link that only needs short messages. All functions are
+  implemented once by the base class "RMsgCore", which takes the lengths at
+  runtime, so that further objects with other lengths cost only their
+  buffers. The message structures (Msg_t, MsgView_t) are the same for all 
+  objects.
+
   void  setStream (Stream *StreamCmd, Stream *StreamDebug);
     Set the stream that is connected to the host/client for all further
     communications. Default stream is "Serial" and that it is connected to the
@@ -46,16 +72,38 @@
     _isHost == true            : object owner is host and connected to client
     _isHost == false (default) : object owner is client and connected to host
 
-  void  beginMsg (token_t token)
-    Starts a message to the host; an already started message is discarded
+  void  setBinaryMode (bool _isBinary)
+  bool  getBinaryMode ()
+    Switch the command stream between ASCII (default) and binary messages.
+    A binary message is the COBS-encoded sequence
+      token (1 byte),
+      per parameter: key (1 byte), n (1 byte), n values (16-bit, little-endian)
+      CRC-16/CCITT-FALSE over the preceding bytes (16-bit, little-endian)
+    terminated by MSG_BinDelimiter (0x00). REM messages carry their text
+    instead of parameters. A tagged message has MSG_BinTagFlag set in the
+    token byte, followed by the tag (1 byte). REM messages sent to an extra debug stream are
+    always ASCII.
 
-  void  appendDataToMsg (char sKey[], char  cFormat, int nData, int data[])
+  void  beginMsg (token_t token)
+  void  beginReplyMsg (token_t token)
+    Starts a message to the host; an already started message is discarded.
+    A reply to a received message is started with "beginReplyMsg" instead,
+    so that it carries the tag of that message (see "setTag"); messages that
+    are sent on their own account (e.g. events, data blocks) use "beginMsg"
+    and are never tagged
+
+  void  appendDataToMsg (char key, char  cFormat, int nData, const int data[])
+  void  appendDataToMsg (char sKey[], char  cFormat, int nData, const int data[])
     Appends a data package to the current message
+      key       := character, parameter key (preferred, as it does not need
+                   a string constant in SRAM)
       sKey[]    := string, parameter key
       cFormat   := character, determines the representation format
                    MSG_DecFormatChr  '=', 12,3456(,79...)
                    MSG_WordFormatChr ':', FFFF(FFFF...)
                    MSG_ByteFormatChr '.', FF(FF...)
+                   (hex values without separators, always 4 and 2 digits,
+                   respectively; accepted by readMsgFromStream, too)
       nData     := number of data elements to append
       data      := data to append
 
@@ -63,10 +111,12 @@
     Finalizes started message
 
   void  sendMsg()
-  void  sendMsg (Msg_t msg)
+  void  sendMsg (const Msg_t& msg)
+  void  sendMsg (const Msg_t* msg)
     Sends the last finalized message or "msg"
 
-  char* convertMsgToStr (Msg_t msg)
+  char* convertMsgToStr (const Msg_t& msg)
+  char* convertMsgToStr (const Msg_t* msg)
     Converts a message structure into a string message
 
   void  clearMsg (Msg_t* msg);
@@ -75,16 +125,37 @@
   char* composeRemMsg (int strCode)
     Compose a remark message
 
-  void  beginRemMsg ()
+  bool  beginRemMsg ()
   void  appendStrToRemMsg (char *s)
   void  sendRemMsg ()
+    Compose and send a remark message in steps. Remarks use the same output
+    buffer as other messages: while a message is composed (between "beginMsg"
+    and "sendMsg"), a remark is refused (beginRemMsg returns false) and 
+    counted as dropped, so that the message is not destroyed. The text is cut
+    at the length of the output buffer (outLen -6 characters in ASCII and 
+    outLen -5 in binary mode, see MSG_MaxOutLen).
 
   void  sendMsg ()
     Send the last composed message
 
-  void  sendMsg (Msg_t msg)
+  void  sendMsg (const Msg_t& msg)
   Send the message contained in the message structure
 
+  Outgoing messages to the command stream are queued (MSG_TxBufLen bytes) and
+  passed to the stream only as fast as "availableForWrite" allows, so that
+  sending does not wait for the serial link. If the queue is full, REM
+  messages are dropped (and later replaced by one "<REM n dropped;"), all
+  other messages wait until enough bytes have been sent. REM messages to an
+  extra debug stream are sent directly.
+
+  void  updateTx ()
+    Passes queued bytes to the stream; called by the read functions, i.e. 
+    once per pass of the main loop, if it polls for messages
+
+  void  flushTx ()
+    Waits until all queued bytes have been passed to the stream; called by
+    "setStream"
+
   void  sendConfimMsg (token_t tok, int errCode, int errValue)
     Depending on error code, it sends an error message or an acknowledgement
     to the host
@@ -98,11 +169,68 @@
     the data. Returns a command token, if a complete message was recognized, and
     the message data, including command and parameter fields, in "msg". Returns
     immediately of no data is available.
+    Never waits for data: only bytes already available are consumed and a
+    partially received message is kept until one of the next calls completes it.
     Except for checking the validity of the token and the message format, this
     routine does not check if the parameter fields match the command. This needs
     to be taken care of by the caller.
+    Replies with an error message (ERR_InvalidOrTooFewParams) if the parameter
+    list cannot be parsed; the error value is the position of the offending 
+    character (0=first character of the token).
     For message structure see class RMsgClass.
 
+  token_t readMsgViewFromStream(MsgView_t* view)
+    Like "readMsgFromStream" but does not copy the values into a "Msg_t" 
+    structure; instead, "view" describes each parameter (key, format, number
+    of values) and where its values start in the input buffer. The view is 
+    only valid until the next call of one of the read functions. The number
+    of values per parameter is not limited to TOK_MaxData.
+
+  void  beginViewData (const MsgView_t* view, byte iParam, MsgDataIter_t* it)
+  bool  nextViewData (MsgDataIter_t* it, int* val)
+    Iterate over the values of parameter "iParam" of a view, e.g.
+      RMsg.beginViewData(&view, 0, &it);
+      while (RMsg.nextViewData(&it, &val)) { ... }
+
+  bool  setHandler (token_t tok, MsgHandler_t handler)
+    Registers a handler for messages with token "tok" (NULL removes it; up to 
+    MSG_MaxHandlers tokens), which receives the parameters one by one while
+    they are scanned, instead of a "Msg_t" or "MsgView_t":
+      bool handler(byte event, char key, int val)
+    with "event"
+      MSG_Hdl_Begin  message starts, "val" is the token
+      MSG_Hdl_Param  next parameter, with "key"
+      MSG_Hdl_Value  next value of parameter "key"
+      MSG_Hdl_End    message complete, "val" is ERR_None or, if the message
+                     was rejected or discarded, the error code
+    Returning false rejects the message (ERR_InvalidOrTooFewParams, as for
+    a syntax error). The read functions then return the token with an empty
+    parameter list once the message is complete. In ASCII mode, the 
+    parameters are passed on as the characters arrive and are not stored, so
+    that the number of parameters and values is not limited (e.g. to upload 
+    a waveform); binary messages are passed on after their checksum has been
+    verified and are therefore limited by the input buffer.
+
+  int   getTag ()
+  void  setTag (int tag)
+    Messages can carry a tag (0..MSG_MaxTag) after the token, e.g.
+      >SDV#17 P=1 V=1;
+    which is echoed by the reply (<ACK#17 C=8;), so that a host can have 
+    several commands outstanding and still match the replies. The tag is 
+    only used by a reply, i.e. the next message started with "beginReplyMsg"
+    (also by sendConfirmMsg and sendVerMsg), and thereby used up; other 
+    messages sent meanwhile (beginMsg, e.g. an event caused by the command) 
+    do not carry it. "getTag" returns the tag of the last received message 
+    (MSG_NoTag if none), "setTag" sets the tag of the next reply instead. A
+    tag not used by a reply is discarded by the next call of a read function.
+
+  const MsgStats_t* getStats ()
+  void  resetStats ()
+    Counters of received, rejected and sent messages (see MsgStats_t); the
+    counters saturate at 0xFFFF. A message is counted as a transmit stall, if
+    sending it had to wait for space in the transmit queue (or, if there is
+    none, in the buffer of the stream).
+
   char* getPtrToInBuf ()
 
   bool  checkMsg (Msg_t* msg, bool asCmd)
@@ -139,8 +267,9 @@
 #define         TOK_MaxMsgLen_bytes    2 +2*TOK_MaxParams +2*TOK_MaxParams*TOK_MaxData
 #define         TOK_isCommand          true
 #define         TOK_isReply            true
+#define         TOK_HashSize           64    // slots of the token hash table
 
-extern char     msgTokens[TOK_LastIndex+1][TOK_StrLength+1];
+extern const char msgTokens[TOK_LastIndex+1][TOK_StrLength+1] PROGMEM;
 
 typedef byte    token_t;
 typedef struct  {
@@ -152,6 +281,44 @@ typedef struct  {
                 } Msg_t;                            // 154
 typedef byte    MsgBuf_t[TOK_MaxMsgLen_bytes];
 
+typedef struct  {
+  char          key;                                //  1
+  char          fmt;                                //  1  format character
+  byte          nData;                              //  1
+  byte          offs;                               //  1  first value in "Buf"
+                } MsgParamView_t;                   //  4
+typedef struct  {
+  token_t       tok;                                //  1
+  byte          nParams;                            //  1
+  MsgParamView_t param[TOK_MaxParams];              // 12  = 4*3
+                } MsgView_t;                        // 14
+typedef struct  {
+  const char*   p;
+  char          fmt;
+  byte          nLeft;
+                } MsgDataIter_t;
+
+#define         MSG_Hdl_Begin          0     // events of a parameter handler
+#define         MSG_Hdl_Param          1
+#define         MSG_Hdl_Value          2
+#define         MSG_Hdl_End            3
+
+typedef bool    (*MsgHandler_t)(byte event, char key, int val);
+
+#define         MSG_RxErr_Token        0     // token not recognized
+#define         MSG_RxErr_Params       1     // parameters could not be parsed
+#define         MSG_RxErr_Checksum     2     // binary message corrupted
+#define         MSG_RxErr_TooLong      3     // message did not fit into buffer
+#define         MSG_nRxErrs            4
+
+typedef struct  {
+  word          nRx;                                // messages received
+  word          nRxErrs[MSG_nRxErrs];               // messages rejected
+  unsigned long nTxBytes;                           // bytes sent
+  word          nTxStalls;                          // messages that had to wait
+  word          nTxDropped;                         // REM messages dropped
+                } MsgStats_t;
+
 /*--------------------------------------------------------------------------------
   Error codes
   --------------------------------------------------------------------------------*/
@@ -161,6 +328,9 @@ typedef byte    MsgBuf_t[TOK_MaxMsgLen_bytes];
 #define         ERR_InvalidOrTooFewParams           4
 #define         ERR_CmdNotImplemented               5
 #define         ERR_DeviceNotReady                  6
+#define         ERR_BufferOverrun                   7
+#define         ERR_ChecksumError                   8
+#define         ERR_TooLate                         9
 #define         ERR_I2C_Error                       20
                 /* 1, data too long to fit in transmit buffer
                    2, received NACK on transmit of address
@@ -175,7 +345,6 @@ typedef byte    MsgBuf_t[TOK_MaxMsgLen_bytes];
 #define         MSG_MaxOutLen          512 // 127
 */
 #define         MSG_MinInLen           3
-#define         MSG_MaxConvBufLen      10
 #define         MSG_StartChr_Client    '<'
 #define         MSG_StartChr_Host      '>'
 #define         MSG_SpacerChr          " "
@@ -185,51 +354,167 @@ typedef byte    MsgBuf_t[TOK_MaxMsgLen_bytes];
 #define         MSG_DecFormatChr       '='
 #define         MSG_WordFormatChr      ':'
 #define         MSG_ByteFormatChr      '.'
+#define         MSG_BinFormatChr       0x00  // view of a binary message
+#define         MSG_TagChr             '#'   // optional tag after the token
+#define         MSG_MaxTag             255
+#define         MSG_NoTag              -1
+
+#define         SCN_TokenEnd           0     // states of the parameter scanner
+#define         SCN_Space              1
+#define         SCN_Format             2
+#define         SCN_DecStart           3
+#define         SCN_DecSign            4
+#define         SCN_DecDigits          5
+#define         SCN_HexStart           6
+#define         SCN_HexDigits          7
+
+#define         MSG_BinDelimiter       0x00
+#define         MSG_BinTrailerLen      3     // CRC and delimiter
+#define         MSG_BinCRCInit         0xFFFF
+#define         MSG_BinTagFlag         0x80  // in token byte: tag byte follows
 
 //--------------------------------------------------------------------------------
 // Class RMsg
 //--------------------------------------------------------------------------------
-class RMsgClass
+class RMsgCore
 {
   public:
-    RMsgClass();
     void    setStream(Stream *StreamCmd, Stream *StreamDebug);
     void    setIsHost(bool _isHost);
+    void    setBinaryMode(bool _isBinary);
+    bool    getBinaryMode();
 
     void    beginMsg(token_t token);
-    void    appendDataToMsg(char sKey[], char  cFormat, int nData, int data[]);
+    void    beginReplyMsg(token_t token);
+    void    appendDataToMsg(char key, char  cFormat, int nData, const int data[]);
+    void    appendDataToMsg(char sKey[], char  cFormat, int nData, const int data[]);
     char*   finalizeMsg();
-    char*   convertMsgToStr(Msg_t msg);
+    char*   convertMsgToStr(const Msg_t& msg);
+    char*   convertMsgToStr(const Msg_t* msg);
     char*   composeRemMsg(int strCode);
     void    clearMsg(Msg_t* msg);
 
     token_t readMsgFromStream(Msg_t* msg);
+    token_t readMsgViewFromStream(MsgView_t* view);
+    void    beginViewData(const MsgView_t* view, byte iParam, MsgDataIter_t* it);
+    bool    nextViewData(MsgDataIter_t* it, int* val);
+    bool    setHandler(token_t tok, MsgHandler_t handler);
+    int     getTag();
+    void    setTag(int tag);
+    const MsgStats_t* getStats();
+    void    resetStats();
     char*   getPtrToInBuf();
     bool    checkMsg(Msg_t* msg, bool asCmd);
 
     void    sendMsg();
-    void    sendMsg(Msg_t msg);
+    void    sendMsg(const Msg_t& msg);
+    void    sendMsg(const Msg_t* msg);
     void    sendConfirmMsg(token_t tok, int errCode, int errValue);
     void    sendRemMsg(int strCode);
     void    sendRemMsg(char *s);
-    void    beginRemMsg();
+    bool    beginRemMsg();
     void    appendStrToRemMsg(char *s);
     void    sendRemMsg();
     void    sendVerMsg(int ver, int freeRAM);
+    void    updateTx();
+    void    flushTx();
+
+  protected:
+    RMsgCore(char* _inBuf, byte _inLen, char* _outBuf, byte _outLen, 
+             uint8_t* _txBuf, word _txLen);
 
   private:
-    char    msgOutBuf[MSG_MaxOutLen +1];
+    char*   msgOutBuf;
+    byte    outLen;
     int     iMsgOutBuf;
-    char    Buf[MSG_MaxInLen +1];
+    char*   Buf;
+    byte    inLen;
     int     nBuf;
-    char    convStrBuf[MSG_MaxConvBufLen];
+    boolean isInMsg;
     Stream* cmdStream;
     Stream* debugStream;
     boolean isMsgStarted;
+    bool    isRemMsg;                  // the started message is a REM
     bool    isClient;
+    bool    isBinary, isOutBinary;
     char    chStartClient, chStartHost;
+    MsgStats_t stats;
+    int     rxTag, txTag;
+    uint8_t* txBuf;
+    word    txLen, iTxHead, iTxTail, nTx;
+    word    nTxDroppedSince;
+
+    token_t hdlTok[MSG_MaxHandlers];
+    MsgHandler_t hdlFunc[MSG_MaxHandlers];
+    byte    nHandlers;
+    bool    isStreaming, isHeaderDone;
+
+    // Parameter scanner state
+    byte    scnState;
+    word    scnPos;
+    bool    scnIsNeg;
+    byte    scnHexLen, scnNDigits;
+    word    scnVal;
+    Msg_t*  scnMsg;
+    MsgView_t* scnView;
+    MsgHandler_t scnHandler;
+    token_t scnTok;
+    char    scnKey;
+
+    bool    receiveMsg();
+    token_t parseMsg(Msg_t* msg, MsgView_t* view);
+    int     parseTag();
+    void    startMsg(token_t token, int tag);
+    token_t findToken(const char* s);
+    MsgHandler_t findHandler(token_t tok);
+    bool    beginHandler(token_t tok, word pos);
+    bool    beginStream();
+    token_t endStream(Msg_t* msg, MsgView_t* view);
+    void    abortStream();
+    void    failHandler(int errCode, int errValue);
+    void    beginScan(Msg_t* msg, MsgView_t* view, word pos);
+    bool    scanChar(char ch);
+    bool    endScan();
+    bool    addScannedParam(char key);
+    bool    addScannedValue();
+    void    appendDataToMsg(const char* sKey, byte nKey, char cFormat, int nData, 
+                            const int data[]);
+    void    appendBinDataToMsg(char key, int nData, const int data[]);
+    void    writeMsgOut(Stream *stream, bool canDrop);
+    void    putTx(const uint8_t* p, word n);
+    void    pumpTx(word nFree);
+    token_t decodeBinMsg(Msg_t* msg, MsgView_t* view);
+};
+
+//--------------------------------------------------------------------------------
+template <int InLen, int OutLen, int TxLen>
+class RMsgT : public RMsgCore
+{
+  static_assert(InLen >= MSG_MinInLen, 
+                "The input buffer must hold a token: InLen must be >= MSG_MinInLen");
+  static_assert(InLen <= 255, 
+                "Positions in the input buffer are counted in bytes: InLen must be <= 255");
+  static_assert(OutLen <= 253, 
+                "Binary messages are COBS-encoded in place: OutLen must be <= 253");
+  static_assert((TxLen == 0) || (TxLen >= OutLen +2), 
+                "The transmit queue must hold a message: TxLen must be 0 or >= OutLen +2");
+
+  public:
+    RMsgT() 
+      : RMsgCore(inBuf, InLen, outBuf, OutLen, txQueue, TxLen) {}
+    // A copy gets its own buffers (i.e. a fresh object)
+    RMsgT(const RMsgT&) 
+      : RMsgT() {}
+    RMsgT& operator=(const RMsgT&) = delete;
+
+  private:
+    char    inBuf[InLen +1];
+    char    outBuf[OutLen +1];
+    uint8_t txQueue[(TxLen > 0) ? TxLen : 1];
 };
 
+typedef RMsgT<MSG_MaxInLen, MSG_MaxOutLen, MSG_TxBufLen>  RMsgClass;
+
 #ifndef RMsg_NoPreinstantiatedObject
 extern RMsgClass  RMsg;
 #endif
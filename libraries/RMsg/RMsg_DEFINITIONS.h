@@ -21,6 +21,21 @@
     with x,      command index
     </>ACK C=x;
 
+  - Any command can carry a tag t (0..255) after the token, which is echoed by
+    the reply (ACK, ERR or data), e.g.
+    >SDV#t P=1 V=1;
+    <ACK#t C=8;
+
+  - Switches between ASCII and binary messages (see RMsg.h); the reply is
+    sent in the previous format
+    with m,      0=ASCII (default), 1=binary
+    >BIN M=m;
+
+  - Reports loop timing and message statistics (hex words, see status.ino
+    of the sketch); with R=1 the statistics are reset after the reply
+    >STA [R=1];
+    <STA L:min,avg,max H:bins T:times R:counts X:counts;
+
 
 
   Hardware-specific:
@@ -37,10 +52,15 @@
   * Define I/O mode of up to 8 digital pins (=servo ports of the Watterott
     Robot Controller).
     with [x,..]  servo port index (1...8)
-         [y,..]  mode, mode, 0=input, 1=input_low, 2=output, 3=servo
+         [y,..]  mode, mode, 0=input, 1=input_low, 2=output, 3=servo,
+                 4=input_edge
 		             "input"    requires an external pulldown resistor
 				         "input_lo" uses the internal 2k pullup resistor
 				          (=> closed == LOW!)
+                 "input_edge" like "input" but not debounced; outputs
+                 linked by SDT follow each level change; changes lost
+                 because the queue was full are reported (n) as
+                 <ERR C=7 E=7,n;
     >SDM P=x1,x2... M=y1,y2...;
 
   * Set up to 8 digital pin (=servo ports of the Watterott Robot Controller)
@@ -49,16 +69,63 @@
          [y,..]  value, for output pins : 0=low, 1=high
                         for servo pins  : 0..255 as angle (not degrees)
     >SDV P=x1,x2... V=y1,y2...;
+    With T, the output pins are set "ms" milliseconds plus "us" microseconds
+    (0..999) after the last SYN, from a timer interrupt; if this time has
+    passed, they are set immediately and the reply is an error with the
+    delay n in [ms] (up to 8 timed commands can be pending; servo pins
+    cannot be timed)
+    >SDV P=x1,x2... V=y1,y2... T=ms,us;
+    <ERR C=8 E=9,n;
+
+  * Set the sync point for timed outputs (SDV with T); SDM, SDT and CLR
+    discard pending timed outputs
+    >SYN;
+
+  * Set the debouncing window of up to 8 digital input pins (=servo ports of
+    the Watterott Robot Controller)
+    with [x,..]  servo port index (1...8)
+         [y,..]  window, 1..16 samples taken once per ms (default: 10)
+    >SDD P=x1,x2... D=y1,y2...;
 
   * Clear all function entries
     >CLR;
 
   * Start/stop sampling vom analog inputs #0 and 1
-    with rate,   0=stop, >0 rate in [us]
-         range,  1=1.1V, analogReference(INTERNAL)
+    with rate,   0=stop, >0 rate in [us] (>=200)
+         range,  2=2.56V, analogReference(INTERNAL) on the ATmega32U4
+                 (1=1.1V on other microcontrollers)
                  3=2.3V, analogReference(EXTERNAL), with Aref->3.3V
                  5=5.0V, analogReference(DEFAULT)
     >REC r=rate,range;
+    The samples are sent in blocks, with a1,.. and b1,.. values of inputs #0
+    and #1, respectively; lost samples (n) are reported as an error
+    <REC A=a1,a2,... B=b1,b2,...;
+    <ERR C=13 E=7,n;
+
+  * Step table played by the device (see sequence.ino of the sketch): clear
+    the table, append a step (ports x1,.. set to y1,.., then wait d [ms]),
+    play (m=1, n runs; m=2, endless) or stop (m=0); when the playback ends,
+    the device reports the completed runs n and the next step s
+    >SQC;
+    >SQA P=x1,x2... V=y1,y2... D=d;
+    >SQP M=m,n;
+    <SQP N=n S=s;
+
+  * SRAM budget: sizes of .data, .bss and heap (D), of the RMsg object,
+    its transmit queue, the port list, the sample buffer, the step table and
+    the messages (B), peak stack use, smallest and current free SRAM (S), all
+    in bytes; with R=1 the peak is reset after the reply
+    >MEM [R=1];
+    <MEM D=data,bss,heap B=msg,tx,ports,rec,seq,cmds S=peak,min,now;
+
+  * Collect commands (up to 6 of SDM, SDV, SDT, SDD, CLR, REC and SQC, SQA,
+    SQP, with up to 48 values together) and apply them together with END,
+    which replies once with the error code r1,.. of each command; n commands
+    failed, y=4: none applied, y=3: applied with invalid values
+    >BEG;
+    >END;
+    <ACK C=16 R=r1,r2...;
+    <ERR C=16 E=y,n R=r1,r2...;
 
 
   --------------------------------------------------------------------------------*/
@@ -68,7 +135,9 @@
 #define TOK_MaxParams          3
 #define TOK_MaxData            8
 #define MSG_MaxInLen         127
-#define MSG_MaxOutLen        127
+#define MSG_MaxOutLen        132   // longest reply: STA with tag
+#define MSG_TxBufLen         192   // transmit queue (bytes), 0=send directly
+#define MSG_MaxHandlers        2   // tokens with a parameter handler
 
 #define TOK_NONE             255
 #define TOK_REM                0
@@ -77,6 +146,7 @@
 #define TOK_ACK                3
 #define TOK_STA                4
 #define TOK_DUM                5
+#define TOK_BIN                6
 
 // ===============================================================================
 // USER DEFINED ==>
@@ -84,14 +154,26 @@
 /*--------------------------------------------------------------------------------
   Command tokens
   --------------------------------------------------------------------------------*/
-#define TOK_SDM                6
-#define TOK_SDV                7
-#define TOK_SDT                8
-#define TOK_CLR				         9
-#define TOK_I2W                10
-#define TOK_I2R                11
-#define TOK_REC                12
-#define TOK_LastIndex          12
+#define TOK_SDM                7
+#define TOK_SDV                8
+#define TOK_SDT                9
+#define TOK_CLR				         10
+#define TOK_I2W                11
+#define TOK_I2R                12
+#define TOK_REC                13
+#define TOK_SDD                14
+#define TOK_BEG                15
+#define TOK_END                16
+#define TOK_SYN                17
+#define TOK_SQC                18
+#define TOK_SQA                19
+#define TOK_SQP                20
+#define TOK_MEM                21
+#define TOK_LastIndex          21
+
+// Seed of the token hash; if the compiler reports a collision after tokens
+// were added, try other values (1..255)
+#define TOK_HashSeed           38
 
 /*--------------------------------------------------------------------------------
   Status codes
@@ -3,11 +3,14 @@
 
 /*--------------------------------------------------------------------------------
   Command token strings
+  (Stored in flash memory; also used by the compiler to generate the token 
+  hash table)
   --------------------------------------------------------------------------------*/
-extern char     msgTokens[TOK_LastIndex+1][TOK_StrLength+1]
-                = {"REM", "VER", "ERR", "ACK", "STA", "DUM",
+extern constexpr char msgTokens[TOK_LastIndex+1][TOK_StrLength+1] PROGMEM
+                = {"REM", "VER", "ERR", "ACK", "STA", "DUM", "BIN",
                    "SDM", "SDV", "SDT", "CLR", "I2W", "I2R",
-                   "REC"
+                   "REC", "SDD", "BEG", "END", "SYN",
+                   "SQC", "SQA", "SQP", "MEM"
                   };
 
 /*--------------------------------------------------------------------------------
@@ -39,6 +39,25 @@ Servo    S_objs[RCS_maxServoPorts];
 //--------------------------------------------------------------------------------
 RobotCSClass::RobotCSClass () 
 {
+  volatile uint8_t* reg;
+  int j, k;
+
+  nSOutRegs = 0;
+  for(j=0; j<RCS_maxServoPorts; j+=1) {
+	  SInReg[j] = portInputRegister(digitalPinToPort(S_portPins[j]));
+	  SBit[j]   = digitalPinToBitMask(S_portPins[j]);
+	  reg       = portOutputRegister(digitalPinToPort(S_portPins[j]));
+	  for(k=0; (k < nSOutRegs) && (SOutRegs[k] != reg); k+=1);
+	  if(k == nSOutRegs)
+	    SOutRegs[nSOutRegs++] = reg;
+	  SOutRegIdx[j] = k;
+  }
+  EdgePorts      = 0;
+  EdgePCIntPorts = 0;
+  EdgeLevels     = 0;
+  iEdgeHead      = 0;
+  iEdgeTail      = 0;
+  nEdgesLost     = 0;
   reset();
 }
 
@@ -47,11 +66,16 @@ void  RobotCSClass::reset ()
 {
   int j;
 
+  for(j=0; j<RCS_maxServoPorts; j+=1) 
+	  detachEdgeInput(j);
   for(j=0; j<RCS_maxMotorPorts; j+=1) 
 	  MPorts[j] = 0;
   for(j=0; j<RCS_maxServoPorts; j+=1) {
 	  SPorts[j] = 0;
 	  pinMode(S_portPins[j], INPUT);
+	  DBHist[j]  = 0;
+	  DBLevel[j] = 0;
+	  DBMask[j]  = (1 << RCS_defDebounce_ms) -1;
   }
   isReady = true;
 }
@@ -86,6 +110,8 @@ int   RobotCSClass::initServo(int _iPort)
   }
   S_objs[_iPort].attach(S_portPins[_iPort]);
   SPorts[_iPort] = 1;
+
+  return 0;
 }
 
 //--------------------------------------------------------------------------------
@@ -114,26 +140,338 @@ int   RobotCSClass::getArduinoPin(int _iServoPort)
   return S_portPins[_iServoPort];
 }
 
+//--------------------------------------------------------------------------------
+void  RobotCSClass::writeDigitalOutputs(uint8_t _ports, uint8_t _levels)
+// Sets the servo ports in "_ports" (bit j = port j, configured as outputs) to 
+// the levels in "_levels" (bit j, 1=HIGH). The bits are collected per output
+// register, which is then changed with one read-modify-write with interrupts
+// disabled: outputs of the same register switch in the same cycle, the others
+// a few cycles apart. Unlike "digitalWrite", PWM on the pins is not turned off.
+// Can be called from an interrupt routine
+{
+  uint8_t  setMask[RCS_maxServoPorts], clrMask[RCS_maxServoPorts];
+  uint8_t  j, k, bit;
+  volatile uint8_t* reg;
+#if defined(SREG)
+  uint8_t  oldSREG;
+#endif
+
+  for(k=0; k<nSOutRegs; k+=1) {
+    setMask[k] = 0;
+    clrMask[k] = 0;
+  }
+  for(j=0, bit=1; j<RCS_maxServoPorts; j+=1, bit<<=1) {
+    if(_ports & bit) {
+      if(_levels & bit)
+        setMask[SOutRegIdx[j]] |= SBit[j];
+      else  
+        clrMask[SOutRegIdx[j]] |= SBit[j];
+    }
+  }
+#if defined(SREG)
+  oldSREG = SREG;
+#endif
+  noInterrupts();
+  for(k=0; k<nSOutRegs; k+=1) {
+    if(setMask[k] | clrMask[k]) {
+      reg  = SOutRegs[k];
+      *reg = (*reg & ~clrMask[k]) | setMask[k];
+    }
+  }
+#if defined(SREG)
+  SREG = oldSREG;
+#else
+  interrupts();
+#endif
+}
+
 //--------------------------------------------------------------------------------
 int   RobotCSClass::readDigitalDebounced(int _iServoPort)
+// Returns the debounced level of the servo port without waiting: the pin is 
+// sampled at most once per millisecond and the level changes only when all 
+// samples within the port's window agree
 {
-  int val, j;
+  uint8_t  t;
+  uint16_t h;
 
-  val = 0;
-  for(int j=0; j<5; j+=1) {
-	  val += 10*digitalRead(S_portPins[_iServoPort]);
-    delay(2);
+  if((_iServoPort < 0) || (_iServoPort >= RCS_maxServoPorts))
+    return 0;
+
+  t = (uint8_t)millis();
+  if(t != DBTick[_iServoPort]) {
+    DBTick[_iServoPort] = t;
+    h = (DBHist[_iServoPort] << 1) | (digitalRead(S_portPins[_iServoPort]) == HIGH);
+    DBHist[_iServoPort] = h;
+    h &= DBMask[_iServoPort];
+    if(h == DBMask[_iServoPort])
+      DBLevel[_iServoPort] = HIGH;
+    else if(h == 0)
+      DBLevel[_iServoPort] = LOW;
   }
-  if(val > 40)
-    return 1;
+  return DBLevel[_iServoPort];
+}
 
-  return 0;
+//--------------------------------------------------------------------------------
+int   RobotCSClass::setDebounce(int _iServoPort, int _window_ms)
+// Sets the debouncing window (1..RCS_maxDebounce_ms samples) of a servo port
+{
+  if((_iServoPort < 0) || (_iServoPort >= RCS_maxServoPorts) || 
+     (_window_ms < 1) || (_window_ms > RCS_maxDebounce_ms)) 
+    return -1;
+
+  DBMask[_iServoPort] = (uint16_t)((1UL << _window_ms) -1);
+  resetDebounce(_iServoPort);
+  return _window_ms;
+}
+
+//--------------------------------------------------------------------------------
+void  RobotCSClass::resetDebounce(int _iServoPort)
+// Takes the current level of the pin as debounced level, e.g. after the port
+// was (re)configured as input
+{
+  if((_iServoPort < 0) || (_iServoPort >= RCS_maxServoPorts))
+    return;
+
+  DBLevel[_iServoPort] = (digitalRead(S_portPins[_iServoPort]) == HIGH);
+  DBHist[_iServoPort]  = DBLevel[_iServoPort] ? 0xFFFF : 0;
+  DBTick[_iServoPort]  = (uint8_t)millis();
+}
+
+//--------------------------------------------------------------------------------
+int   RobotCSClass::attachEdgeInput(int _iServoPort)
+// Puts a servo port (configured as input) into edge mode: level changes are
+// time-stamped and queued, to be retrieved with "readEdge". Uses a pin-change
+// interrupt if the pin supports one (result: 1); otherwise the pin has to be
+// checked regularly by calling "pollEdgeInputs" (result: 0)
+{
+  uint8_t  bit;
+#if defined(SREG)
+  uint8_t  oldSREG;
+#endif
+
+  if((_iServoPort < 0) || (_iServoPort >= RCS_maxServoPorts)) 
+    return -1;
+
+  bit = 1 << _iServoPort;
+#if defined(SREG)
+  oldSREG = SREG;
+#endif
+  noInterrupts();
+  if(*SInReg[_iServoPort] & SBit[_iServoPort])
+    EdgeLevels |= bit;
+  else  
+    EdgeLevels &= ~bit;
+  EdgePorts |= bit;
+#if defined(PCICR)
+  uint8_t  pin = S_portPins[_iServoPort];
+
+  if(digitalPinToPCICR(pin) != NULL) {
+    *digitalPinToPCMSK(pin) |= _BV(digitalPinToPCMSKbit(pin));
+    *digitalPinToPCICR(pin) |= _BV(digitalPinToPCICRbit(pin));
+    EdgePCIntPorts |= bit;
+  }
+#endif
+#if defined(SREG)
+  SREG = oldSREG;
+#else
+  interrupts();
+#endif
+  return (EdgePCIntPorts & bit) ? 1 : 0;
+}
+
+//--------------------------------------------------------------------------------
+void  RobotCSClass::detachEdgeInput(int _iServoPort)
+{
+  uint8_t  bit;
+#if defined(SREG)
+  uint8_t  oldSREG;
+#endif
+
+  if((_iServoPort < 0) || (_iServoPort >= RCS_maxServoPorts)) 
+    return;
+
+  bit = 1 << _iServoPort;
+#if defined(SREG)
+  oldSREG = SREG;
+#endif
+  noInterrupts();
+#if defined(PCICR)
+  uint8_t  pin = S_portPins[_iServoPort];
+
+  if(EdgePCIntPorts & bit) {
+    // The pin-change interrupt of the pin group stays enabled; pins without
+    // mask bit do not trigger it
+    *digitalPinToPCMSK(pin) &= ~_BV(digitalPinToPCMSKbit(pin));
+  }
+#endif
+  EdgePorts      &= ~bit;
+  EdgePCIntPorts &= ~bit;
+#if defined(SREG)
+  SREG = oldSREG;
+#else
+  interrupts();
+#endif
+}
+
+//--------------------------------------------------------------------------------
+bool  RobotCSClass::pushEdge(uint8_t _iServoPort, uint8_t _level, unsigned long _t_us)
+// Queues an edge; needs to be called with interrupts disabled. If the queue is
+// full, the newest edge of the port is replaced, so that the final level wins
+// (the pulse in between is lost); if there is none, false is returned and the
+// edge is lost, the caller then keeps the old level, so that the change is 
+// detected again by "pollEdgeInputs"
+{
+  uint8_t iNext = (iEdgeHead +1) & (RCS_edgeQueueLen -1);
+  uint8_t i;
+
+  if(iNext == iEdgeTail) {
+    for(i=iEdgeHead; i!=iEdgeTail; ) {
+      i = (i -1) & (RCS_edgeQueueLen -1);
+      if(EdgeQueue[i].port == _iServoPort) {
+        EdgeQueue[i].level = _level;
+        EdgeQueue[i].t_us  = _t_us;
+        nEdgesLost = (nEdgesLost < 254) ? nEdgesLost +2 : 255;
+        return true;
+      }
+    }
+    if(nEdgesLost < 255)
+      nEdgesLost += 1;
+    return false;
+  }
+  EdgeQueue[iEdgeHead].port  = _iServoPort;
+  EdgeQueue[iEdgeHead].level = _level;
+  EdgeQueue[iEdgeHead].t_us  = _t_us;
+  iEdgeHead = iNext;
+  return true;
+}
+
+//--------------------------------------------------------------------------------
+void  RobotCSClass::onPinChange()
+// Called from the pin-change interrupt; checks all ports that use pin-change
+// interrupts for a new level
+{
+  unsigned long t_us = micros();
+  uint8_t       j, bit, lev;
+
+  for(j=0, bit=1; j<RCS_maxServoPorts; j+=1, bit<<=1) {
+	  if(EdgePCIntPorts & bit) {
+      lev = (*SInReg[j] & SBit[j]) ? bit : 0;
+      if((lev != (EdgeLevels & bit)) && pushEdge(j, lev ? HIGH : LOW, t_us))
+        EdgeLevels ^= bit;
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------
+void  RobotCSClass::pollEdgeInputs()
+// Checks the ports in edge mode that have no pin-change interrupt for a new 
+// level; to be called regularly, e.g. from the main loop. Ports with pin-
+// change interrupt are checked, too, to catch up on edges that did not fit
+// into the queue
+{
+  uint8_t       j, bit, lev;
+#if defined(SREG)
+  uint8_t       oldSREG;
+#endif
+
+  if(EdgePorts == 0)
+    return;
+
+  for(j=0, bit=1; j<RCS_maxServoPorts; j+=1, bit<<=1) {
+	  if(EdgePorts & bit) {
+      lev = (*SInReg[j] & SBit[j]) ? bit : 0;
+      if(lev != (EdgeLevels & bit)) {
+        // Check again with interrupts disabled, the pin-change interrupt 
+        // may have queued the edge meanwhile
+        //
+#if defined(SREG)
+        oldSREG = SREG;
+#endif
+        noInterrupts();
+        lev = (*SInReg[j] & SBit[j]) ? bit : 0;
+        if((lev != (EdgeLevels & bit)) && pushEdge(j, lev ? HIGH : LOW, micros()))
+          EdgeLevels ^= bit;
+#if defined(SREG)
+        SREG = oldSREG;
+#else
+        interrupts();
+#endif
+      }
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------
+bool  RobotCSClass::readEdge(RCSEdge_t* _edge)
+// Retrieves the oldest queued edge; returns false if there is none
+{
+#if defined(SREG)
+  uint8_t  oldSREG;
+#endif
+
+  if(iEdgeTail == iEdgeHead)
+    return false;
+
+  // With interrupts disabled, as "pushEdge" may replace the entry
+  //
+#if defined(SREG)
+  oldSREG = SREG;
+#endif
+  noInterrupts();
+  _edge->port  = EdgeQueue[iEdgeTail].port;
+  _edge->level = EdgeQueue[iEdgeTail].level;
+  _edge->t_us  = EdgeQueue[iEdgeTail].t_us;
+  iEdgeTail    = (iEdgeTail +1) & (RCS_edgeQueueLen -1);
+#if defined(SREG)
+  SREG = oldSREG;
+#else
+  interrupts();
+#endif
+  return true;
+}
+
+//--------------------------------------------------------------------------------
+uint8_t  RobotCSClass::getEdgesLost()
+// Returns the number of edges lost because the queue was full (saturates at 
+// 255) since the last call
+{
+  uint8_t  n;
+#if defined(SREG)
+  uint8_t  oldSREG;
+
+  oldSREG = SREG;
+#endif
+  noInterrupts();
+  n          = nEdgesLost;
+  nEdgesLost = 0;
+#if defined(SREG)
+  SREG = oldSREG;
+#else
+  interrupts();
+#endif
+  return n;
+}
+
+//--------------------------------------------------------------------------------
+#if defined(PCICR)
+#if defined(PCINT0_vect)
+ISR(PCINT0_vect) 
+{ 
+  RobotCS.onPinChange(); 
 }
+#endif
+#if defined(PCINT1_vect)
+ISR(PCINT1_vect, ISR_ALIASOF(PCINT0_vect));
+#endif
+#if defined(PCINT2_vect)
+ISR(PCINT2_vect, ISR_ALIASOF(PCINT0_vect));
+#endif
+#endif
 
 //--------------------------------------------------------------------------------
 // Preinstantiate Object
 // 
-RobotCSClass RobotCS = RobotCSClass();
+RobotCSClass RobotCS;
 
 //--------------------------------------------------------------------------------
 
@@ -20,6 +20,9 @@
   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
   History:  v0.1 File created, very rudimentary support so far
+            v0.2 2026-10-17, non-blocking debouncing of digital inputs
+                             edge-triggered inputs (pin-change interrupts)
+                             simultaneous digital outputs (writeDigitalOutputs)
 
   --------------------------------------------------------------------------------*/
 #if defined(ARDUINO) && ARDUINO >= 100
@@ -50,6 +53,18 @@
 #define    RCS_S7              6
 #define    RCS_S8              7
 
+#define    RCS_defDebounce_ms  10  // debouncing window, in samples taken at
+#define    RCS_maxDebounce_ms  16  // most once per millisecond
+
+#define    RCS_edgeQueueLen    8   // must be a power of 2
+
+//--------------------------------------------------------------------------------
+typedef struct {
+  uint8_t       port;              // servo port index
+  uint8_t       level;             // new level, LOW or HIGH
+  unsigned long t_us;              // time of the edge (micros())
+              } RCSEdge_t;
+
 //--------------------------------------------------------------------------------
 // Class RobotCSClass
 //--------------------------------------------------------------------------------
@@ -66,12 +81,49 @@ class RobotCSClass
 	  int     writeServo_Position(int _iPort, int _pos);
 
 	  int     getArduinoPin(int _iServoPort);
+	  void    writeDigitalOutputs(uint8_t _ports, uint8_t _levels);
 	  int     readDigitalDebounced(int _iServoPort);
+	  int     setDebounce(int _iServoPort, int _window_ms);
+	  void    resetDebounce(int _iServoPort);
+
+	  int     attachEdgeInput(int _iServoPort);
+	  void    detachEdgeInput(int _iServoPort);
+	  void    pollEdgeInputs();
+	  bool    readEdge(RCSEdge_t* _edge);
+	  uint8_t getEdgesLost();
+	  void    onPinChange();
 
   private: 
     bool    isReady;    
     uint8_t MPorts[RCS_maxMotorPorts];
     uint8_t SPorts[RCS_maxServoPorts];
+
+    // Debouncer state per servo port: the last samples (one bit each), the 
+    // mask of the samples in the window, the debounced level and the 
+    // (low byte of the) time of the last sample
+    uint16_t DBHist[RCS_maxServoPorts];
+    uint16_t DBMask[RCS_maxServoPorts];
+    uint8_t  DBLevel[RCS_maxServoPorts];
+    uint8_t  DBTick[RCS_maxServoPorts];
+
+    // Edge-triggered inputs: input register and bit of each servo port, the 
+    // ports in edge mode (bit per port; those with pin-change interrupt in
+    // "EdgePCIntPorts"), their last level and the queue of detected edges
+    volatile uint8_t*  SInReg[RCS_maxServoPorts];
+    uint8_t            SBit[RCS_maxServoPorts];
+
+    // Output registers of the servo ports (each only once) and the index of
+    // each port's register, to set several outputs at once
+    volatile uint8_t*  SOutRegs[RCS_maxServoPorts];
+    uint8_t            nSOutRegs;
+    uint8_t            SOutRegIdx[RCS_maxServoPorts];
+    volatile uint8_t   EdgePorts, EdgePCIntPorts;
+    volatile uint8_t   EdgeLevels;
+    volatile RCSEdge_t EdgeQueue[RCS_edgeQueueLen];
+    volatile uint8_t   iEdgeHead, iEdgeTail;
+    volatile uint8_t   nEdgesLost;
+
+    bool    pushEdge(uint8_t _iServoPort, uint8_t _level, unsigned long _t_us);
 };    
 
 extern RobotCSClass  RobotCS;